@@ -0,0 +1,41 @@
+//
+//  LocalizedStringReverseIndex.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+/// Explanation:
+/// Maps a uiString back to the (table, key) pairs whose translations could have produced it.
+/// The NSLocalizedStringRecord only knows about strings that were retrieved while the app was running. When AppKit renames something with a string from one of its own tables (e.g. "Show Spelling and Grammar" in the Edit menu),
+/// we don't see the retrieval, so this reads the compiled `.strings` tables directly instead. Right now it's only used to make the error messages more helpful.
+///
+/// Format strings (e.g. `%d files`) can't be looked up by their value, so we bucket them by the first 3 characters of their longest literal segment,
+/// and on a query only run the `formatStringRecognizer()` for the buckets that appear in the uiString.
+///
+/// Notes:
+/// - The index is built lazily on the first query, for the localization the bundle is currently using.
+/// - `.stringsdict` tables aren't indexed.
+/// - Not thread safe.
+
+#import <Foundation/Foundation.h>
+#import "NSLocalizedStringRecord.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface LocalizedStringReverseIndex : NSObject
+
+/// Shared indexes
++ (LocalizedStringReverseIndex *)mainBundleIndex;   /// All the string tables of the app
++ (LocalizedStringReverseIndex *)systemIndex;       /// Known system-defined tables that AppKit uses to rename UI elements behind our back. Only used for error messages - validation doesn't rely on it. (see `_addAnnotations:`)
+
+/// Init
+- (instancetype)initWithBundle:(NSBundle *)bundle tables:(NSArray<NSString *> *_Nullable)tables; /// Pass nil for `tables` to index all the tables in the bundle
+
+/// Query
+- (NSArray<LocalizedStringRecordEntry *> *)candidatesForUIString:(NSString *)uiString; /// Exact matches first, then format string matches
+- (LocalizedStringRecordEntry *_Nullable)firstCandidateForUIString:(NSString *)uiString;
+
+@end
+
+NS_ASSUME_NONNULL_END
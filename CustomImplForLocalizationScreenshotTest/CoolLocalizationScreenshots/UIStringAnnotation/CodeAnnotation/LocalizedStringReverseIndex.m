@@ -0,0 +1,206 @@
+//
+//  LocalizedStringReverseIndex.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+#import "LocalizedStringReverseIndex.h"
+#import "Utility.h"
+@import AppKit;
+
+#define kAnchorLength 3
+
+@implementation LocalizedStringReverseIndex {
+
+    NSBundle *_bundle;
+    NSArray<NSString *> *_tables;
+    BOOL _isBuilt;
+
+    NSMutableDictionary<NSString *, NSMutableArray<LocalizedStringRecordEntry *> *> *_entriesByTranslation;
+    NSMutableDictionary<NSString *, NSMutableArray<LocalizedStringRecordEntry *> *> *_formatEntriesByAnchor;
+    NSMutableArray<LocalizedStringRecordEntry *> *_unanchoredFormatEntries; /// Format strings whose literal segments are all shorter than `kAnchorLength`. These are checked on every query.
+}
+
+#pragma mark - Shared indexes
+
++ (LocalizedStringReverseIndex *)mainBundleIndex {
+    static LocalizedStringReverseIndex *_index = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _index = [[LocalizedStringReverseIndex alloc] initWithBundle:NSBundle.mainBundle tables:nil];
+    });
+    return _index;
+}
+
++ (LocalizedStringReverseIndex *)systemIndex {
+
+    /// Notes:
+    /// - The `MenuCommands` table is where AppKit gets the translations for the standard menu items like "Show Spelling and Grammar". Add more tables here when we find other cases where AppKit renames stuff.
+
+    static LocalizedStringReverseIndex *_index = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _index = [[LocalizedStringReverseIndex alloc] initWithBundle:[NSBundle bundleForClass:[NSApplication class]] tables:@[@"MenuCommands"]];
+    });
+    return _index;
+}
+
+#pragma mark - Init
+
+- (instancetype)initWithBundle:(NSBundle *)bundle tables:(NSArray<NSString *> *)tables {
+    self = [super init];
+    if (self) {
+        _bundle = bundle;
+        _tables = tables;
+        _isBuilt = NO;
+    }
+    return self;
+}
+
+- (void)buildIfNecessary {
+
+    if (_isBuilt) return;
+    _isBuilt = YES;
+
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+    _entriesByTranslation = [NSMutableDictionary dictionary];
+    _formatEntriesByAnchor = [NSMutableDictionary dictionary];
+    _unanchoredFormatEntries = [NSMutableArray array];
+
+    /// Find table files
+    ///     Use the localization that the bundle actually loads its strings from.
+    NSString *localization = _bundle.preferredLocalizations.firstObject;
+    NSMutableArray<NSString *> *tablePaths = [NSMutableArray array];
+    if (_tables == nil) {
+        [tablePaths addObjectsFromArray:[_bundle pathsForResourcesOfType:@"strings" inDirectory:nil forLocalization:localization]];
+    } else {
+        for (NSString *table in _tables) {
+            NSString *path = [_bundle pathForResource:table ofType:@"strings" inDirectory:nil forLocalization:localization];
+            if (path != nil) [tablePaths addObject:path];
+        }
+    }
+
+    /// Index tables
+    NSUInteger entryCount = 0;
+    for (NSString *tablePath in tablePaths) {
+
+        NSString *table = tablePath.lastPathComponent.stringByDeletingPathExtension;
+        NSDictionary<NSString *, NSString *> *translations = [NSDictionary dictionaryWithContentsOfFile:tablePath]; /// Handles both the binary plist and the old-style text format of .strings files
+        if (![translations isKindOfClass:[NSDictionary class]]) continue;
+
+        [translations enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSString *translation, BOOL *stop) {
+
+            if (![translation isKindOfClass:[NSString class]] || translation.length == 0) return;
+
+            LocalizedStringRecordEntry *entry = [[LocalizedStringRecordEntry alloc] initWithKey:key value:nil table:table result:translation]; /// Not interned - the index holds every string of the tables, and the intern pool is never cleared
+
+            /// Exact
+            NSMutableArray *exactEntries = self->_entriesByTranslation[translation];
+            if (exactEntries == nil) {
+                exactEntries = [NSMutableArray array];
+                self->_entriesByTranslation[translation] = exactEntries;
+            }
+            [exactEntries addObject:entry];
+
+            /// Format
+            NSArray<NSString *> *literalSegments = formatStringLiteralSegments(translation);
+            BOOL isFormatString = literalSegments.count > 1;
+            if (isFormatString) {
+
+                NSString *longestSegment = @"";
+                for (NSString *segment in literalSegments) {
+                    if (segment.length > longestSegment.length) longestSegment = segment;
+                }
+
+                /// Skip format strings without literal content - they'd match anything. (And `formatStringRecognizer()` asserts against them)
+                if ([longestSegment stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceAndNewlineCharacterSet].length == 0) {
+                    return;
+                }
+
+                /// Lowercase since the recognizer is case insensitive
+                ///     Lowercase the whole segment before cutting out the anchor - lowercasing can change the length (e.g. "İ" becomes 2 UTF-16 units), and the queries look up windows of exactly `kAnchorLength` units of the lowercased uiString.
+                NSString *lowercaseSegment = longestSegment.lowercaseString;
+                
+                if (lowercaseSegment.length < kAnchorLength) {
+                    [self->_unanchoredFormatEntries addObject:entry];
+                } else {
+                    NSString *anchor = [lowercaseSegment substringToIndex:kAnchorLength];
+                    NSMutableArray *anchoredEntries = self->_formatEntriesByAnchor[anchor];
+                    if (anchoredEntries == nil) {
+                        anchoredEntries = [NSMutableArray array];
+                        self->_formatEntriesByAnchor[anchor] = anchoredEntries;
+                    }
+                    [anchoredEntries addObject:entry];
+                }
+            }
+        }];
+        entryCount += translations.count;
+    }
+
+    if (MFVerbosityIsEnabled(MFVerbosityVerbose)) {
+        NSLog(@"LocalizedStringReverseIndex: Indexed %lu strings from %lu tables in %@ (%@) in %.1f ms", (unsigned long)entryCount, (unsigned long)tablePaths.count, _bundle.bundlePath.lastPathComponent, localization, (CFAbsoluteTimeGetCurrent() - startTime) * 1000.0);
+    }
+}
+
+#pragma mark - Query
+
+- (LocalizedStringRecordEntry *)firstCandidateForUIString:(NSString *)uiString {
+
+    /// Fast path
+    [self buildIfNecessary];
+    LocalizedStringRecordEntry *exactMatch = _entriesByTranslation[uiString].firstObject;
+    if (exactMatch != nil) {
+        return exactMatch;
+    }
+
+    /// Slow path
+    return [self candidatesForUIString:uiString].firstObject;
+}
+
+- (NSArray<LocalizedStringRecordEntry *> *)candidatesForUIString:(NSString *)uiString {
+
+    [self buildIfNecessary];
+
+    NSMutableArray<LocalizedStringRecordEntry *> *result = [NSMutableArray array];
+    if (uiString.length == 0) return result;
+
+    /// Exact matches
+    NSArray *exactMatches = _entriesByTranslation[uiString];
+    if (exactMatches != nil) {
+        [result addObjectsFromArray:exactMatches];
+    }
+
+    /// Collect format string candidates
+    ///     Every format string that matches must contain its anchor, so it's in the bucket of one of the windows of the uiString.
+    NSMutableOrderedSet<LocalizedStringRecordEntry *> *formatCandidates = [NSMutableOrderedSet orderedSet];
+    [formatCandidates addObjectsFromArray:_unanchoredFormatEntries];
+    if (_formatEntriesByAnchor.count > 0) {
+        NSString *lowercaseUIString = uiString.lowercaseString;
+        for (NSUInteger i = 0; i + kAnchorLength <= lowercaseUIString.length; i++) {
+            NSArray *bucket = _formatEntriesByAnchor[[lowercaseUIString substringWithRange:NSMakeRange(i, kAnchorLength)]];
+            if (bucket != nil) {
+                [formatCandidates addObjectsFromArray:bucket];
+            }
+        }
+    }
+
+    /// Verify format string candidates
+    ///     The `formatStringRecognizer()` also matches uiStrings that only *contain* the format string - it captures the surrounding text in its first and last group.
+    ///     We only want format strings that produce the whole uiString, so we require those groups to be empty.
+    for (LocalizedStringRecordEntry *entry in formatCandidates) {
+        if ([result containsObject:entry]) continue;
+        NSRegularExpression *recognizer = formatStringRecognizer(entry.result);
+        NSTextCheckingResult *match = [recognizer firstMatchInString:uiString options:0 range:NSMakeRange(0, uiString.length)];
+        if (match == nil) continue;
+        BOOL coversWholeUIString = [match rangeAtIndex:1].length == 0 && [match rangeAtIndex:match.numberOfRanges - 1].length == 0;
+        if (coversWholeUIString) {
+            [result addObject:entry];
+        }
+    }
+
+    return result;
+}
+
+@end
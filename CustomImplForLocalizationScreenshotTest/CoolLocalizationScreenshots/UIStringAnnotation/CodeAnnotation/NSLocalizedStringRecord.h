@@ -10,17 +10,48 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// LocalizedStringRecordEntry
+///     Represents a single retrieval of a localized string (e.g. through NSLocalizedString())
+///     Notes:
+///     - We previously used an NSDictionary for each retrieval. This is lighter, and the consumers don't have to look up the values by string keys anymore.
+///     - `key`, `value` and `table` are interned (when created via `entryWithKey:...`) - so all entries that have the same key share the same NSString instance. There are only a limited number of distinct keys and tables, but we record a huge number of retrievals.
+///     - `result` is already converted to a pure NSString (without attributes) since that's what all the consumers want. If you need the attributes, use `rawResult`.
+///     - Entries are compared by identity (NSObject's default `isEqual:`), not by their contents. Two retrievals of the same string are two separate entries.
+
+@interface LocalizedStringRecordEntry : NSObject
+
+@property (nonatomic, readonly) NSString *key;
+@property (nonatomic, readonly) NSString *value; /// The developmentString
+@property (nonatomic, readonly) NSString *table;
+@property (nonatomic, readonly) NSString *result; /// The localizedString
+@property (nonatomic, readonly) id rawResult; /// NSString or NSAttributedString
+
++ (instancetype)entryWithKey:(NSString *_Nullable)key value:(NSString *_Nullable)value table:(NSString *_Nullable)table result:(id _Nullable)rawResult;
+- (instancetype)initWithKey:(NSString *_Nullable)key value:(NSString *_Nullable)value table:(NSString *_Nullable)table result:(id _Nullable)rawResult; /// Doesn't intern the strings. Use this for entries that don't come from a retrieval (e.g. decoded ones), so they don't fill up the intern pool.
+- (NSDictionary *)dictionaryRepresentation; /// For logging
+
+@end
+
 @interface NSLocalizedStringRecord : NSObject
 
-+ (Queue <NSDictionary *>*)queue;
-+ (Queue <NSDictionary *>*)systemQueue;
-+ (NSSet <NSDictionary *>*)systemSet;
++ (Queue <LocalizedStringRecordEntry *>*)queue;
++ (void)enqueueEntry:(LocalizedStringRecordEntry *)entry; /// Use this instead of enqueuing on the `queue` directly, so the entry can be found by `removeQueuedEntriesEqualToEntry:`
++ (void)removeQueuedEntriesEqualToEntry:(LocalizedStringRecordEntry *)entry;
++ (LocalizedStringRecordEntry *_Nullable)dequeueEntry;                /// Use these instead of `dequeue` and `removeAllObjects` on the `queue`, so the index behind `removeQueuedEntriesEqualToEntry:` doesn't fill up with stale handles
++ (void)removeAllQueuedEntries;
+
+/// System record
+///     Holds localized strings retrieved from system-defined string tables. (See `_addAnnotations:` for why we need this)
+///     Entries are deduplicated by their `result` when they are recorded, so this doesn't grow with the number of retrievals - only with the number of distinct strings.
++ (LocalizedStringRecordEntry *_Nullable)systemEntryWithResult:(NSString *)result;
++ (void)removeAllSystemEntries;
++ (NSUInteger)systemEntryCount;
 
 #define unpackLocalizedStringRecord(__LocalizedStringRecord) \
-    __unused NSString *m_stringKeyFromRecord = __LocalizedStringRecord[@"key"]; \
-    __unused NSString *m_developmentStringFromRecord = __LocalizedStringRecord[@"value"]; \
-    __unused NSString *m_stringTableFromRecord = __LocalizedStringRecord[@"table"]; \
-    __unused NSString *m_localizedStringFromRecord = __LocalizedStringRecord[@"result"]; \
+    __unused NSString *m_stringKeyFromRecord = (__LocalizedStringRecord).key; \
+    __unused NSString *m_developmentStringFromRecord = (__LocalizedStringRecord).value; \
+    __unused NSString *m_stringTableFromRecord = (__LocalizedStringRecord).table; \
+    __unused NSString *m_localizedStringFromRecord = (__LocalizedStringRecord).result; \
 
 @end
 
@@ -16,6 +16,8 @@
 #import "NSLocalizedStringRecord.h"
 #import "objc/runtime.h"
 #import "Utility.h"
+#import "AnnotationUtility.h"
+#import "CaptureRecording.h"
 
 ///
 /// Forward declare
@@ -28,10 +30,74 @@
 
 @end
 
+///
+/// LocalizedStringRecordEntry
+///
+
+@implementation LocalizedStringRecordEntry
+
+static NSString *internString(NSString *string) {
+    
+    /// Returns a shared instance for each distinct string
+    ///     So that the many entries with the same key / table / value don't each hold their own copy.
+    ///     Note: We never clear the pool, but it only grows with the number of distinct strings, not with the number of retrievals.
+    
+    static NSMutableSet<NSString *> *_pool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _pool = [NSMutableSet set];
+    });
+    
+    @synchronized (_pool) { /// NSLocalizedString() can be called from any thread
+        NSString *result = [_pool member:string];
+        if (result == nil) {
+            result = [string copy];
+            [_pool addObject:result];
+        }
+        return result;
+    }
+}
+
++ (instancetype)entryWithKey:(NSString *)key value:(NSString *)value table:(NSString *)table result:(id)rawResult {
+    return [[LocalizedStringRecordEntry alloc] initWithKey:internString(key ?: @"") value:internString(value ?: @"") table:internString(table ?: @"") result:rawResult];
+}
+
+- (instancetype)initWithKey:(NSString *)key value:(NSString *)value table:(NSString *)table result:(id)rawResult {
+    
+    self = [super init];
+    if (self) {
+        _key = key ?: @"";
+        _value = value ?: @"";
+        _table = table ?: @"";
+        _rawResult = rawResult ?: @"";
+        _result = pureString(_rawResult);
+    }
+    return self;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+        @"key": _key,
+        @"value": _value,
+        @"table": _table,
+        @"result": _rawResult,
+    };
+}
+
+- (NSString *)description {
+    return [[self dictionaryRepresentation] description];
+}
+
+@end
+
 ///
 /// LocalizedStringRecord
 ///
 
+@interface NSLocalizedStringRecord ()
++ (void)recordSystemEntry:(LocalizedStringRecordEntry *)entry;
+@end
+
 @implementation NSLocalizedStringRecord
 
 static Queue *_localizationKeyQueue;
@@ -42,15 +108,112 @@ static Queue *_localizationKeyQueue;
     }
     return _localizationKeyQueue;
 }
-static Queue *_systemLocalizationKeyQueue;
-+ (Queue *)systemQueue {
-    if (_systemLocalizationKeyQueue == nil) {
-        _systemLocalizationKeyQueue = [Queue queue];
+
+static NSMutableDictionary<NSString *, NSMutableIndexSet *> *_queuedHandlesByResult; /// Indexes the `queue` by the entries' `result`, for `removeQueuedEntriesEqualToEntry:`. Kept up to date by the `...QueuedEntr...` methods below - if you remove entries from the `queue` directly, their handles go stale until the queue is empty.
+
++ (void)enqueueEntry:(LocalizedStringRecordEntry *)entry {
+    
+    QueueHandle handle = [self.queue enqueue:entry];
+    
+    if (_queuedHandlesByResult == nil) {
+        _queuedHandlesByResult = [NSMutableDictionary dictionary];
+    }
+    NSMutableIndexSet *handles = _queuedHandlesByResult[entry.result];
+    if (handles == nil) {
+        handles = [NSMutableIndexSet indexSet];
+        _queuedHandlesByResult[entry.result] = handles;
+    }
+    [handles addIndex:handle];
+}
+
+static void forgetQueuedHandle(QueueHandle handle, NSString *result) {
+    NSMutableIndexSet *handles = _queuedHandlesByResult[result];
+    [handles removeIndex:handle];
+    if (handles != nil && handles.count == 0) {
+        [_queuedHandlesByResult removeObjectForKey:result];
+    }
+}
+
++ (LocalizedStringRecordEntry *)dequeueEntry {
+    
+    /// Get the handle of the first entry
+    __block QueueHandle handle = 0;
+    __block LocalizedStringRecordEntry *entry = nil;
+    [self.queue enumerateObjectsUsingBlock:^(LocalizedStringRecordEntry *obj, QueueHandle h, BOOL *stop) {
+        entry = obj;
+        handle = h;
+        *stop = YES;
+    }];
+    if (entry == nil) return nil;
+    
+    /// Remove
+    [self.queue removeObjectWithHandle:handle];
+    forgetQueuedHandle(handle, entry.result);
+    
+    return entry;
+}
+
++ (void)removeAllQueuedEntries {
+    [self.queue removeAllObjects];
+    [_queuedHandlesByResult removeAllObjects];
+}
+
++ (void)removeQueuedEntriesEqualToEntry:(LocalizedStringRecordEntry *)entry {
+    
+    /// Removes all entries from the queue that have the same key, value, table and result as `entry` (including `entry` itself)
+    ///     Only looks at the entries with the same result, so this is O(number of equal entries), not O(queue size).
+    
+    NSString *result = entry.result;
+    NSMutableIndexSet *handles = _queuedHandlesByResult[result];
+    if (handles == nil) return;
+    
+    NSMutableIndexSet *handlesToForget = [NSMutableIndexSet indexSet];
+    [handles enumerateIndexesUsingBlock:^(NSUInteger handle, BOOL * _Nonnull stop) {
+        LocalizedStringRecordEntry *queuedEntry = [self.queue objectForHandle:handle];
+        if (queuedEntry == nil) {
+            [handlesToForget addIndex:handle]; /// Stale
+        } else if ([queuedEntry.key isEqual:entry.key] && [queuedEntry.value isEqual:entry.value] && [queuedEntry.table isEqual:entry.table]) {
+            [self.queue removeObjectWithHandle:handle];
+            [handlesToForget addIndex:handle];
+        }
+    }];
+    [handles removeIndexes:handlesToForget];
+    if (handles.count == 0) {
+        [_queuedHandlesByResult removeObjectForKey:result];
+    }
+    
+    /// Drop stale handles
+    ///     (In case someone removed entries from the `queue` directly.)
+    if (self.queue.isEmpty) {
+        [_queuedHandlesByResult removeAllObjects];
     }
-    return _systemLocalizationKeyQueue;
 }
-+ (NSSet *)systemSet { /// The system set contains tons of duplicates which we don't care about.
-    return [NSSet setWithArray:[self systemQueue]._rawStorage];
+
+static NSMutableDictionary<NSString *, LocalizedStringRecordEntry *> *_systemEntriesByResult;
++ (NSMutableDictionary<NSString *, LocalizedStringRecordEntry *> *)systemEntriesByResult {
+    if (_systemEntriesByResult == nil) {
+        _systemEntriesByResult = [NSMutableDictionary dictionary];
+    }
+    return _systemEntriesByResult;
+}
++ (void)recordSystemEntry:(LocalizedStringRecordEntry *)entry {
+    
+    /// Notes:
+    /// - The system retrieves tons of duplicate strings. We only keep the first entry for each result, since we only ever look up entries by result.
+    /// - Empty results can't be found on any UI element, so we don't record them.
+    
+    if (entry.result.length == 0) return;
+    if (self.systemEntriesByResult[entry.result] != nil) return;
+    self.systemEntriesByResult[entry.result] = entry;
+}
++ (LocalizedStringRecordEntry *)systemEntryWithResult:(NSString *)result {
+    return self.systemEntriesByResult[result];
+}
++ (void)removeAllSystemEntries {
+    [self.systemEntriesByResult removeAllObjects];
+}
++ (NSUInteger)systemEntryCount {
+    return self.systemEntriesByResult.count;
 }
 
 //+ (void)unpackRecord:(NSDictionary *)e callback:(void (^)(NSString *key, NSString *value, NSString *table, NSString *result))callback {
@@ -67,6 +230,24 @@ static Queue *_systemLocalizationKeyQueue;
 
 @implementation NSBundle (LocalizationKeyAnnotations)
 
+static void recordLocalizedStringRetrieval(NSBundle *bundle, NSString *key, NSString *value, NSString *tableName, id result) {
+    
+    /// Create element
+    LocalizedStringRecordEntry *newElement = [LocalizedStringRecordEntry entryWithKey:key value:value table:tableName result:result];
+    
+    /// Enqueue
+    BOOL isSystemString = [[bundle systemTables] containsObject:tableName] || ![bundle isEqual:NSBundle.mainBundle];
+    
+    /// Record
+    MFCaptureRecordLocalizedStringRetrieval(tableName, key, value, newElement.result, isSystemString); /// Pass the pure string - `result` is an NSAttributedString when it comes from `localizedAttributedStringForKey:`
+    
+    if (!isSystemString) {
+        [NSLocalizedStringRecord enqueueEntry:newElement];
+    } else {
+        [NSLocalizedStringRecord recordSystemEntry:newElement];
+    }
+}
+
 + (void)load {
     
     /// TODO: Only swizzle, when some special 'MF_AX_INSPECTABLE_LOCALIZATION_KEYS' flag is set
@@ -76,22 +257,8 @@ static Queue *_systemLocalizationKeyQueue;
         /// Call og
         NSString *result = OGImpl(key, value, tableName);
         
-        /// Create element
-        NSDictionary *newElement = @{
-            @"key": key,
-            @"value": value ?: @"",
-            @"table": tableName ?: @"",
-            @"result": result ?: @"",
-        };
-        
-        /// Enqueue
-        BOOL isSystemString = [[m_self systemTables] containsObject:tableName] || ![m_self isEqual:NSBundle.mainBundle];
-        
-        if (!isSystemString) {
-            [NSLocalizedStringRecord.queue enqueue:newElement];
-        } else {
-            [NSLocalizedStringRecord.systemQueue enqueue:newElement];
-        }
+        /// Record
+        recordLocalizedStringRetrieval(m_self, key, value, tableName, result);
         
         /// Return
         return result;
@@ -102,22 +269,8 @@ static Queue *_systemLocalizationKeyQueue;
         /// Call og
         NSAttributedString *result = OGImpl(key, value, tableName);
         
-        /// Create element
-        NSDictionary *newElement = @{
-            @"key": key,
-            @"value": value ?: @"",
-            @"table": tableName ?: @"",
-            @"result": result ?: @"",
-        };
-        
-        /// Enqueue
-        BOOL isSystemString = [[m_self systemTables] containsObject:tableName] || ![m_self isEqual:NSBundle.mainBundle];
-        
-        if (!isSystemString) {
-            [NSLocalizedStringRecord.queue enqueue:newElement];
-        } else {
-            [NSLocalizedStringRecord.systemQueue enqueue:newElement];
-        }
+        /// Record
+        recordLocalizedStringRetrieval(m_self, key, value, tableName, result);
         
         /// Return
         return result;
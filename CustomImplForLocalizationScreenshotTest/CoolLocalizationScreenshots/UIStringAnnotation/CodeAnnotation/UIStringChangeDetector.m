@@ -7,6 +7,7 @@
 
 #import "UIStringChangeDetector.h"
 #import "NSLocalizedStringRecord.h"
+#import "LocalizedStringReverseIndex.h"
 #import "AnnotationUtility.h"
 #import "NibDecodingAnalysis.h"
 #import "NSString+Additions.h"
@@ -16,6 +17,8 @@
 #import "NSString+Additions.h"
 #import "objc/runtime.h"
 #import "NSRunLoop+Additions.h"
+#import "Trace.h"
+#import "CaptureRecording.h"
 
 @interface UIStringChangeInterceptor : NSObject
 @end
@@ -26,12 +29,12 @@
 /// RunLoop observation
 ///
 
-static NSMutableSet<NSDictionary *> *_recordedStringsUsedThisRunLoop;
-void markLocalizedStringRecordEntryAsUsedForThisRunLoop(NSDictionary *entry) {
+static NSMutableIndexSet *_recordedStringsUsedThisRunLoop; /// Holds the `QueueHandle`s of the used entries in `NSLocalizedStringRecord.queue`
+void markLocalizedStringRecordEntryAsUsedForThisRunLoop(QueueHandle entryHandle) {
     if (_recordedStringsUsedThisRunLoop == nil) {
-        _recordedStringsUsedThisRunLoop = [NSMutableSet set];
+        _recordedStringsUsedThisRunLoop = [NSMutableIndexSet indexSet];
     }
-    [_recordedStringsUsedThisRunLoop addObject:entry];
+    [_recordedStringsUsedThisRunLoop addIndex:entryHandle];
 }
 
 + (void)load {
@@ -40,14 +43,23 @@ void markLocalizedStringRecordEntryAsUsedForThisRunLoop(NSDictionary *entry) {
     [NSRunLoop.mainRunLoop observeLoopActivities:kCFRunLoopBeforeTimers withCallback:^(CFRunLoopObserverRef  _Nonnull observer, CFRunLoopActivity activity) { /// kCFRunLoopBeforeTimers is the earliest time in the runLoop iteration we can observe.
         
         /// Remove the used strings from the record
-        [NSLocalizedStringRecord.queue._rawStorage removeObjectsInArray:_recordedStringsUsedThisRunLoop.allObjects];
+        ///     Note: We remove all entries that are *equal* to a used entry - not just the used entry itself. So if you retrieve the same localizedString twice but only set it once, that's fine.
+        [_recordedStringsUsedThisRunLoop enumerateIndexesUsingBlock:^(NSUInteger handle, BOOL * _Nonnull stop) {
+            LocalizedStringRecordEntry *usedEntry = [NSLocalizedStringRecord.queue objectForHandle:handle];
+            if (usedEntry != nil) {
+                [NSLocalizedStringRecord removeQueuedEntriesEqualToEntry:usedEntry];
+            }
+        }];
         
         /// Clear state
-        [_recordedStringsUsedThisRunLoop removeAllObjects];
+        [_recordedStringsUsedThisRunLoop removeAllIndexes];
+        
+        /// Record
+        MFCaptureRecordRunLoopTick();
         
         /// Validate
-        NSArray *unhandledStrings = NSLocalizedStringRecord.queue._rawStorage;
-        if (unhandledStrings.count > 0) {
+        if (!NSLocalizedStringRecord.queue.isEmpty) {
+            NSArray *unhandledStrings = NSLocalizedStringRecord.queue.peekAll;
             NSLog(@"    UIStringChangeDetector: Error: Unhandled localizedStrings in the NSLocalizedStringRecord after last runLoop iteration: %@\nThis might be due to a bug in the NSLocalizedStringRecord or UIStringChangeDetector code or because the UIStringChangeDetector is not yet capable of detecting you setting the string on a UI Element in the way that you did.\nThe error could also be because the strings are defined by the system, instead of your app and the the code failed to recognize this and properly ignore the system strings.\n\nTip: If you did retrieve these localized strings in your code (probably using NSLocalizedString()) but you just didn't set them to a UI Element immediately, and instead you want to store the strings and set them to a UI Element later, then you can solve this error by telling the system about this through calling <...>.", unhandledStrings);
             assert(false);
         }
@@ -108,11 +120,17 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     /// Convert to pure NSString
     NSString *newlySetStringPure = pureString(newlySetStringRaw);
-
-    /// Define convenience var
-    ///     For logging
-    NSString *descriptionOfUIStringChange = [NSString stringWithFormat:@"[%@ %s\"%@\"]", NSStringFromClass([object class]), sel_getName(selector), newlySetStringPure];
     
+    /// Record
+    ///     Do this before the skips, so a replay sees the same calls that we see here. (Only look up the image when recording, since that's slow.)
+    if (MFCaptureRecordingIsEnabled()) {
+        CaptureUIStringSetFlags flags = 0;
+        if ([getExecutablePath() isEqual:getImagePath(returnAddress)])  flags |= CaptureUIStringSetFlagIsFromExecutable;
+        if (MFIsLoadingNib())                                           flags |= CaptureUIStringSetFlagIsLoadingNib;
+        if (MFSystemIsChangingUIStrings())                              flags |= CaptureUIStringSetFlagSystemIsRenaming;
+        MFCaptureRecordUIStringSet([object class], selector, newlySetStringPure, recursionDepth, flags);
+    }
+
     /// Skip - default cases
     if (MFIsLoadingNib() || MFSystemIsChangingUIStrings()) {
         return;
@@ -127,6 +145,11 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
 //        NSLog(@"    UIStringChangeDetector: Debug: uiStringChange %@ comes from current image: %@", descriptionOfUIStringChange, symbolOfStringChanger);
     }
     
+    /// Define convenience var
+    ///     For logging
+    ///     (Only build this after the skips above, since most uiString changes are skipped)
+    NSString *descriptionOfUIStringChange = [NSString stringWithFormat:@"[%@ %s\"%@\"]", NSStringFromClass([object class]), sel_getName(selector), newlySetStringPure];
+    
     /// Set up recursion handling
     
     static BOOL _doWaitForNextRecursion = NO;
@@ -138,7 +161,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     #define waitForNextRecursion() \
         assert(recursionDepth != 0); /** We're always notified of the deepest recursion first, so when we see recursionDepth 0 that was the last recursion */\
-        NSLog(@"    UIStringChangeDetector: Info: %@ (recursionDepth %ld) (on %@) --- Waiting for next recursion", descriptionOfUIStringChange, recursionDepth, object); \
+        MFTrace(MFVerbosityVerbose, MFTraceEventUIStringChange, (__bridge void *)object, recursionDepth, 1, descriptionOfUIStringChange.UTF8String); \
         _doWaitForNextRecursion = YES; \
         return;
     
@@ -153,7 +176,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
 //    }
     
     /// Log
-    NSLog(@"    UIStringChangeDetector: Info: %@ (recursionDepth %ld) (on %@)", descriptionOfUIStringChange, recursionDepth, object);
+    MFTrace(MFVerbosityVerbose, MFTraceEventUIStringChange, (__bridge void *)object, recursionDepth, 0, descriptionOfUIStringChange.UTF8String);
     
     ///
     /// Main work
@@ -168,7 +191,8 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     ///
     
     /// Declare loop results.
-    NSMutableArray<NSDictionary *> *recordEntriesMatchingNewlySetString = [NSMutableArray array];
+    NSMutableArray<LocalizedStringRecordEntry *> *recordEntriesMatchingNewlySetString = [NSMutableArray array];
+    NSMutableIndexSet *recordHandlesMatchingNewlySetString = [NSMutableIndexSet indexSet]; /// The `QueueHandle`s of the `recordEntriesMatchingNewlySetString`
     BOOL newlySetStringWasCompletelyMatchedWithRecordedStrings = NO;
     
     if (_localizedStringsComposingNextUpdate != nil) {
@@ -182,18 +206,18 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
 
         assert(![_localizedStringsComposingNextUpdate containsObject:newlySetStringPure]);
         
-        for (NSDictionary *entry in NSLocalizedStringRecord.queue.peekAll) {
+        [NSLocalizedStringRecord.queue enumerateObjectsUsingBlock:^(LocalizedStringRecordEntry *entry, QueueHandle handle, BOOL *stop) {
             
-            unpackLocalizedStringRecord(entry);
-            NSString *recordedString = pureString(m_localizedStringFromRecord);
+            NSString *recordedString = entry.result;
             
             for (id s in _localizedStringsComposingNextUpdate) {
                 NSString *sPure = pureString(s);
                 if ([sPure isEqual:recordedString]) {
                     [recordEntriesMatchingNewlySetString addObject:entry];
+                    [recordHandlesMatchingNewlySetString addIndex:handle];
                 }
             }
-        }
+        }];
         
         if (recordEntriesMatchingNewlySetString.count == 0) {
             assert(false);
@@ -210,84 +234,97 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
         
         /// Declare loop state
         NSString *uiStringRemainder = [newlySetStringPure copy];
-        NSInteger localizedStringRecordIndex = 0;
         
-        while (true) {
-            
-            if (NSLocalizedStringRecord.queue.peekAll.count == 0) {
-                /// Update result
-                newlySetStringWasCompletelyMatchedWithRecordedStrings = NO;
-                /// Break
-                break;
-            }
-            
-            /// Unpack localizedStringRecord entry
-            NSDictionary *localizedStringRecordEntry = NSLocalizedStringRecord.queue.peekAll[localizedStringRecordIndex];
-            unpackLocalizedStringRecord(localizedStringRecordEntry);
-            if (m_localizedStringFromRecord.length == 0) {
-                assert(false); /// Not sure how to handle this.
-                continue;
-            }
-            
-            /// Remove attributes
-            NSString *recordedString = pureString(m_localizedStringFromRecord);
-            
-            /// Declare match state
-            BOOL isExactMatch = NO;
-            BOOL isPartialMatch = NO;
-            NSString *newUIStringRemainder = nil;
-            
-            /// Check match
-            
-            /// Check 1: Exact equivalence
-            isExactMatch = [recordedString isEqual:uiStringRemainder];
+        /// Snapshot the pending record entries
+        ///     Notes:
+        ///     - We remove entries from `candidates` once they matched, so each recorded string is only attributed to the uiString once.
+        ///     - We cache the markdown-stripped version of each recorded string (`NSNull` means not computed yet), since parsing markdown is slow and we might look at each candidate several times.
+        ///     - `candidateHandles` holds the `QueueHandle` of each candidate, so we can later find it in the queue again without comparing entries. (Lookup and removal by handle are O(log n), see Queue.h)
+        NSMutableArray<LocalizedStringRecordEntry *> *candidates = [NSMutableArray arrayWithCapacity:NSLocalizedStringRecord.queue.count];
+        NSMutableArray<NSNumber *> *candidateHandles = [NSMutableArray arrayWithCapacity:NSLocalizedStringRecord.queue.count];
+        NSMutableArray *candidatesWithoutMarkdown = [NSMutableArray arrayWithCapacity:NSLocalizedStringRecord.queue.count];
+        [NSLocalizedStringRecord.queue enumerateObjectsUsingBlock:^(LocalizedStringRecordEntry *entry, QueueHandle handle, BOOL *stop) {
+            [candidates addObject:entry];
+            [candidateHandles addObject:@(handle)];
+            [candidatesWithoutMarkdown addObject:NSNull.null];
+        }];
+        
+        /// Main loop
+        ///     Explanation:
+        ///     - Each pass walks all remaining candidates once. When a candidate partially matches, we remove it from the uiStringRemainder and keep going with the next candidate (instead of restarting at index 0, which made this quadratic).
+        ///     - If a pass made progress, we do another pass, since the shorter remainder might now exactly match a candidate that we already looked at. If a pass made no progress, we're done.
+        ///     - `uiStringByRemovingLocalizedString()` prefilters with the literal segments of the recorded string, so candidates that don't appear in the remainder are cheap to reject.
+        BOOL didMakeProgress = YES;
+        while (didMakeProgress && candidates.count > 0 && !newlySetStringWasCompletelyMatchedWithRecordedStrings) {
             
-            /// Check 2: Exact equivalence after removing markdown formatting
-            if (!isExactMatch) {
-                recordedString = removeMarkdownFormatting(recordedString);
-                isExactMatch = [recordedString isEqual:uiStringRemainder];
-            }
+            didMakeProgress = NO;
             
-            /// Check 3: Use regex for partial matching
-            if (!isExactMatch) {
-                newUIStringRemainder = uiStringByRemovingLocalizedString(uiStringRemainder, recordedString);
-                if (![newUIStringRemainder isEqual:uiStringRemainder]) {
-                    isPartialMatch = YES; /// Remainder has changed, meaning that the recordedString was found inside the remainder
+            for (NSUInteger i = 0; i < candidates.count; i++) {
+                
+                /// Unpack localizedStringRecord entry
+                LocalizedStringRecordEntry *localizedStringRecordEntry = candidates[i];
+                unpackLocalizedStringRecord(localizedStringRecordEntry);
+                if (m_localizedStringFromRecord.length == 0) {
+                    assert(false); /// Not sure how to handle this.
+                    continue;
                 }
-            }
-            
-            /// Update loop state
-            
-            if (isExactMatch || isPartialMatch) {
                 
-                /// Update result
-                ///     - Store matched recordedString
-                [recordEntriesMatchingNewlySetString addObject:localizedStringRecordEntry];
+                /// Get pure string
+                NSString *recordedString = m_localizedStringFromRecord;
                 
-                if (isExactMatch) {
-                    /// Update result
-                    newlySetStringWasCompletelyMatchedWithRecordedStrings = YES;
-                    /// Break
-                    break;
+                /// Declare match state
+                BOOL isExactMatch = NO;
+                BOOL isPartialMatch = NO;
+                NSString *newUIStringRemainder = nil;
+                
+                /// Check match
+                
+                /// Check 1: Exact equivalence
+                isExactMatch = [recordedString isEqual:uiStringRemainder];
+                
+                /// Check 2: Exact equivalence after removing markdown formatting
+                if (!isExactMatch) {
+                    if (candidatesWithoutMarkdown[i] == NSNull.null) {
+                        candidatesWithoutMarkdown[i] = removeMarkdownFormatting(recordedString);
+                    }
+                    recordedString = candidatesWithoutMarkdown[i];
+                    isExactMatch = [recordedString isEqual:uiStringRemainder];
                 }
                 
-                if (isPartialMatch) {
-                    /// Update remainder
-                    uiStringRemainder = newUIStringRemainder;
-                    /// Restart iteration through localizedString record
-                    localizedStringRecordIndex = 0;
+                /// Check 3: Use regex for partial matching
+                if (!isExactMatch) {
+                    newUIStringRemainder = uiStringByRemovingLocalizedString(uiStringRemainder, recordedString);
+                    if (![newUIStringRemainder isEqual:uiStringRemainder]) {
+                        isPartialMatch = YES; /// Remainder has changed, meaning that the recordedString was found inside the remainder
+                    }
                 }
                 
-            } else { /// No match
+                /// Update loop state
                 
-                if (localizedStringRecordIndex < NSLocalizedStringRecord.queue._rawStorage.count - 1) {
-                    /// Move to next recordedString
-                    localizedStringRecordIndex += 1;
-                } else {
+                if (isExactMatch || isPartialMatch) {
+                    
                     /// Update result
-                    newlySetStringWasCompletelyMatchedWithRecordedStrings = NO;
-                    /// Break
-                    break;
+                    ///     - Store matched recordedString
+                    [recordEntriesMatchingNewlySetString addObject:localizedStringRecordEntry];
+                    [recordHandlesMatchingNewlySetString addIndex:candidateHandles[i].unsignedLongLongValue];
+                    
+                    if (isExactMatch) {
+                        /// Update result
+                        newlySetStringWasCompletelyMatchedWithRecordedStrings = YES;
+                        /// Break
+                        break;
+                    }
+                    
+                    if (isPartialMatch) {
+                        /// Update remainder
+                        uiStringRemainder = newUIStringRemainder;
+                        /// Remove the matched candidate and stay at the same index
+                        [candidates removeObjectAtIndex:i];
+                        [candidateHandles removeObjectAtIndex:i];
+                        [candidatesWithoutMarkdown removeObjectAtIndex:i];
+                        i -= 1;
+                        didMakeProgress = YES;
+                    }
                 }
             }
         }
@@ -301,13 +338,14 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
         
         /// Validate loop result
         if (!newlySetStringWasCompletelyMatchedWithRecordedStrings || recordEntriesMatchingNewlySetString.count == 0) {
-            NSLog(@"    UIStringChangeDetector: Error: Couldn't fully match the detected uiStringChange with entries from the NSLocalizedStringRecord. Remember to call `nextUIStringUpdateIsComposedOfRawLocalizedStrings:` before <...>\n\n    Detected change: %@\n    Current record: %@", descriptionOfUIStringChange, NSLocalizedStringRecord.queue._rawStorage);
+            NSLog(@"    UIStringChangeDetector: Error: Couldn't fully match the detected uiStringChange with entries from the NSLocalizedStringRecord. Remember to call `nextUIStringUpdateIsComposedOfRawLocalizedStrings:` before <...>\n\n    Detected change: %@\n    Current record: %@\n    Candidates from the app's string tables: %@", descriptionOfUIStringChange, NSLocalizedStringRecord.queue, [LocalizedStringReverseIndex.mainBundleIndex candidatesForUIString:newlySetStringPure]);
             assert(false);
         }
     }
     
     /// DEBUG
-    NSLog(@"    UIStringChangeDetector: Debug: LocalizedStringRecord before removing matched string (%@): %@", newlySetStringPure, NSLocalizedStringRecord.queue._rawStorage);
+    ///     (We used to log the whole record here, which was really slow. Now we only trace its size.)
+    MFTrace(MFVerbosityDebug, MFTraceEventLocalizedStringRecord, NSLocalizedStringRecord.queue.count, 0, 0, newlySetStringPure.UTF8String);
     
     ///
     /// Attach ax annotation
@@ -324,11 +362,11 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     }
     
     /// Attach annotations to the object
-    for (NSDictionary *record in recordEntriesMatchingNewlySetString) {
+    for (LocalizedStringRecordEntry *record in recordEntriesMatchingNewlySetString) {
         
         unpackLocalizedStringRecord(record);
         
-        NSString *localizedStringFromRecordPure = pureString(m_localizedStringFromRecord); /// Should we have the localizedString record just record the strings as pure strings? Making this unnecessary
+        NSString *localizedStringFromRecordPure = m_localizedStringFromRecord; /// The record already stores the pure string
         NSString *mergedUIString = [localizedStringFromRecordPure isEqual:newlySetStringPure] ? nil : newlySetStringPure;
         
         NSAccessibilityElement *annotation = [AnnotationUtility createAnnotationElementWithLocalizationKey:m_stringKeyFromRecord translatedString:localizedStringFromRecordPure developmentString:m_developmentStringFromRecord translatedStringNibKey:nil mergedUIString:mergedUIString];
@@ -339,9 +377,9 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     /// Mark the matched recorded strings as used
     ///
     
-    for (NSDictionary *entry in recordEntriesMatchingNewlySetString) {
-        markLocalizedStringRecordEntryAsUsedForThisRunLoop(entry);
-    }
+    [recordHandlesMatchingNewlySetString enumerateIndexesUsingBlock:^(NSUInteger handle, BOOL * _Nonnull stop) {
+        markLocalizedStringRecordEntryAsUsedForThisRunLoop(handle);
+    }];
 }
 
 @end
@@ -364,14 +402,14 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setToolTip:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setStringValue:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
@@ -379,63 +417,63 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setAttributedStringValue:), MakeInterceptorFactory(void, (NSAttributedString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setPlaceholderString:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setPlaceholderAttributedString:), MakeInterceptorFactory(void, (NSAttributedString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setTitle:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class],  @{ @"framework": @"AppKit" }, @selector(setAttributedTitle:), MakeInterceptorFactory(void, (NSAttributedString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setAlternateTitle:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setAttributedAlternateTitle:), MakeInterceptorFactory(void, (NSAttributedString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setSubtitle:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setLabel:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -445,7 +483,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     ///     detects lots of string changes, but it seems `setStringValue:` also catches all the cases I could observe. Still swizzling because why not.
     swizzleMethodOnClassAndSubclasses([NSObject class], @{ @"framework": @"AppKit" }, @selector(setObjectValue:), MakeInterceptorFactory(void, (NSObject *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             if ([newValue isKindOfClass:[NSString class]] || [newValue isKindOfClass:[NSAttributedString class]]) {
                 [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
@@ -458,7 +496,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
         assert(false); /// We don't know how to handle this.
         
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue, cell);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -467,7 +505,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
         assert(false); /// We don't know how to handle this.
         
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue, index);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -476,7 +514,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
         assert(false); /// We don't know how to handle this. TouchBarItems are complicated and unnecessary.
         
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -491,7 +529,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"AppKit" }, @selector(setToolTip:forSegment:), MakeInterceptorFactory(void, (NSString *newValue, long long segment), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue, segment);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo: @{ @"segment": @(segment) }];
         });
@@ -499,7 +537,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"AppKit" }, @selector(setLabel:forSegment:), MakeInterceptorFactory(void, (NSString *newValue, long long segment), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue, segment);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo: @{ @"segment": @(segment) }];
         });
@@ -513,7 +551,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
 + (void)load {
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"AppKit" }, @selector(setHeaderToolTip:), MakeInterceptorFactory(void, (NSString *newValue), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newValue);
             [UIStringChangeInterceptor handleSetString:newValue onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -633,7 +671,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(setAttributedString:), MakeInterceptorFactory(void, (NSAttributedString *newReplacementString), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newReplacementString);
             [UIStringChangeInterceptor handleSetString:newReplacementString onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -648,7 +686,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([NSText class], @{ @"framework": @"AppKit" }, @selector(setString:), MakeInterceptorFactory(void, (NSString *newReplacementString), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newReplacementString);
             [UIStringChangeInterceptor handleSetString:newReplacementString onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
@@ -657,7 +695,7 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     swizzleMethodOnClassAndSubclasses([NSText class], @{ @"framework": @"AppKit" }, @selector(performValidatedReplacementInRange:withAttributedString:), MakeInterceptorFactory(bool, (NSRange range, NSAttributedString *newSubstring), {
         __block bool result;
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             result = OGImpl(range, newSubstring);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo:@{ @"replacementRange": [NSValue valueWithRange:range] }];
         });
@@ -676,49 +714,49 @@ static NSArray <NSString *>*_localizedStringsComposingNextUpdate = nil;
     
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(appendString:), MakeInterceptorFactory(void, (NSString *newSubstring), { /// appendString: is not declared in the Apple docs but it does exist. I guess it doesn't hurt to intercept.
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newSubstring);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(appendAttributedString:), MakeInterceptorFactory(void, (NSAttributedString *newSubstring), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newSubstring);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));    
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(insertAttributedString:atIndex:), MakeInterceptorFactory(void, (NSAttributedString *newSubstring, unsigned long long index), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newSubstring, index);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo:@{ @"insertionIndex": @(index) }];
         });
     }));    
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(replaceCharactersInRange:withAttributedString:), MakeInterceptorFactory(void, (NSRange range, NSAttributedString *newSubstring), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(range, newSubstring);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo: @{ @"replacementRange": [NSValue valueWithRange:range] }];
         });
     }));    
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(replaceCharactersInRange:withString:), MakeInterceptorFactory(void, (NSRange range, NSAttributedString *newSubstring), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(range, newSubstring);
             [UIStringChangeInterceptor handleSetString:newSubstring onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo: @{ @"replacementRange": [NSValue valueWithRange:range] }];
         });
     }));
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(setAttributedString:), MakeInterceptorFactory(void, (NSAttributedString *newReplacementString), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(newReplacementString);
             [UIStringChangeInterceptor handleSetString:newReplacementString onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress];
         });
     }));
     swizzleMethodOnClassAndSubclasses([self class], @{ @"framework": @"UIFoundation" }, @selector(deleteCharactersInRange:), MakeInterceptorFactory(void, (NSRange range), {
         void *returnAddress = getReturnAddress();
-        countRecursions(@"uiStringChanges", ^(NSInteger recursionDepth) {
+        countRecursions(MFThreadCounterUIStringChanges, ^(NSInteger recursionDepth) {
             OGImpl(range);
             [UIStringChangeInterceptor handleSetString:nil onObject:m_self selector:m__cmd recursionDepth:recursionDepth returnAddress:returnAddress extraInfo:@{ @"didDelete": @YES }];
         });
@@ -13,7 +13,7 @@
 #import "AnnotationUtility.h"
 #import "UINibDecoderIntrospection.h"
 #import "Utility.h"
-#import "TreeNode.h"
+#import "ArenaTree.h"
 #import "KVPair.h"
 #import "NSString+Additions.h"
 #import "SystemRenameTracker.h"
@@ -60,38 +60,28 @@
 /// DecodingDepth defines
 ///
 
-#define MFLoadNibDepthKey @"MFLoadNibDepth"
-
 NSInteger MFLoadNibDepth(void) {
-    return [NSThread.currentThread.threadDictionary[MFLoadNibDepthKey] integerValue];
+    return MFThreadCounterGet(MFThreadCounterLoadNib);
 }
 static void MFLoadNibDepthIncrement(void) {
-    NSInteger d = MFLoadNibDepth() + 1;
-    NSThread.currentThread.threadDictionary[MFLoadNibDepthKey] = @(d);
+    MFThreadCounterIncrement(MFThreadCounterLoadNib);
 }
 static void MFLoadNibDepthDecrement(void) {
-    NSInteger d = MFLoadNibDepth() - 1;
-    assert(d >= 0);
-    NSThread.currentThread.threadDictionary[MFLoadNibDepthKey] = @(d);
+    MFThreadCounterDecrement(MFThreadCounterLoadNib);
 }
 
 BOOL MFIsLoadingNib(void) {
     return MFLoadNibDepth() > 0;
 }
 
-#define MFNibDecoderDepthKey @"MFNibDecoderDepth"
-
 NSInteger MFNibDecoderDepth(void) {
-    return [NSThread.currentThread.threadDictionary[MFNibDecoderDepthKey] integerValue];
+    return MFThreadCounterGet(MFThreadCounterNibDecoder);
 }
-static void MFNibDecoderDepthIncrement(void) { /// We could probably just use our `countRecursions()` function instead of all these `depthIncrement()`, `depthDecrement()` functions.
-    NSInteger d = MFNibDecoderDepth() + 1;
-    NSThread.currentThread.threadDictionary[MFNibDecoderDepthKey] = @(d);
+static void MFNibDecoderDepthIncrement(void) { /// `-decodeObjectForKey:` is called for every key of every decoded object, so this needs to be fast. That's why it's backed by a thread-local counter.
+    MFThreadCounterIncrement(MFThreadCounterNibDecoder);
 }
 static void MFNibDecoderDepthDecrement(void) {
-    NSInteger d = MFNibDecoderDepth() - 1;
-    assert(d >= 0);
-    NSThread.currentThread.threadDictionary[MFNibDecoderDepthKey] = @(d);
+    MFThreadCounterDecrement(MFThreadCounterNibDecoder);
 }
 
 #pragma mark - DecoderRecord storage
@@ -198,8 +188,8 @@ static void postDive(NSString *nibName, NSString *fileName) {
         /// Delete NSLocalizedStringRecord
         ///     We only use the NSLocalizedStringRecord for our CodeAnnotation anyways, but the Nib decoding will clutter it up.
         ///     It's inefficient that we're creating the NSLocalizedString record during NibDecoding.
-        [NSLocalizedStringRecord.queue._rawStorage removeAllObjects];
-        [NSLocalizedStringRecord.systemQueue._rawStorage removeAllObjects];
+        [NSLocalizedStringRecord removeAllQueuedEntries];
+        [NSLocalizedStringRecord removeAllSystemEntries];
         
         /// Validate
         assert(MFNibDecoderDepth() == 0 && MFLoadNibDepth() == 0);
@@ -220,7 +210,7 @@ static void postDive(NSString *nibName, NSString *fileName) {
 ///     The object usuallly uses `[coder decodeObjectForKey:]` to get values from the coder. (There's also other getters such as `decodeFloatForKey:` but we've been doing fine just ignoring all those.)
 ///     `decodeObjectForKey:` seems to be called for all the objects in the object-tree of the nib file in depth-first order. If we swizzle that and add a recursion-counter,
 ///     we can create a list of all the visited nodes - containing the decoded object and its key, as well as the node's depth in the tree.
-///     Then we use that list to recreate the structure of the object-tree in  the nib file (using our `TreeNode` datastructure) and then we can traverse our  tree and find all of the localization keys - and the objects that the keys belong to.
+///     Then we use that list to recreate the structure of the object-tree in  the nib file (using our `ArenaTree` datastructure) and then we can traverse our  tree and find all of the localization keys - and the objects that the keys belong to.
 ///
 ///     Notes:
 ///     - We also tried to directly analyze the NSCoder instance, but it has a weird 'scoping' mechanism - whenever `[coder decodeObjectForKey:]` is called to decode a child-node of the current node,
@@ -272,6 +262,159 @@ static void postDive(NSString *nibName, NSString *fileName) {
 @end
 
 
+#pragma mark - Decoder tree index
+
+///
+/// NibDecoderTreeIndex
+///     Lookup tables over the decoder tree and the topLevelObjects of a nib file.
+///     The Annotator used to linearly search the connectors / topLevelObjects / tree nodes for every localized string it processed, which made annotating a nib O(strings × connectors).
+///     Now we build these tables once per nib load, so each lookup is a hash lookup.
+///     The tables that are only needed for some special cases (tooltips, ax values, window titles) are built lazily on first use.
+///
+
+@interface NibDecoderTreeIndex : NSObject
+- (instancetype)initWithTree:(ArenaTree<KVPair *> *)tree topLevelObjects:(NSArray *)topLevelObjects;
+- (NSIndexSet *)nodesWithKey:(NSString *)key;
+- (id _Nullable)topLevelValueForKey:(NSString *)key;
+- (NSIBHelpConnector *_Nullable)helpConnectorWithMarker:(NSString *)marker;
+- (NSNibAXAttributeConnector *_Nullable)accessibilityConnectorWithAttributeValue:(NSString *)attributeValue;
+- (NSWindow *_Nullable)windowWithContentView:(NSView *)contentView;
+- (NSMenu *_Nullable)mainMenu;
+@end
+
+@implementation NibDecoderTreeIndex {
+    ArenaTree<KVPair *> *_tree;
+    NSArray *_topLevelObjects;
+    NSMutableDictionary<NSString *, NSMutableIndexSet *> *_nodesByKey;
+    NSMutableDictionary<NSString *, id> *_topLevelValuesByKey;
+    NSMapTable<NSString *, NSIBHelpConnector *> *_helpConnectorsByMarker;
+    NSMutableDictionary<NSString *, NSNibAXAttributeConnector *> *_accessibilityConnectorsByAttributeValue;
+    NSMapTable<NSView *, NSWindow *> *_windowsByContentView;
+}
+
+- (instancetype)initWithTree:(ArenaTree<KVPair *> *)tree topLevelObjects:(NSArray *)topLevelObjects {
+    
+    self = [super init];
+    if (self) {
+        
+        _tree = tree;
+        _topLevelObjects = topLevelObjects;
+        
+        /// Index all nodes by key
+        _nodesByKey = [NSMutableDictionary dictionary];
+        for (ArenaTreeIndex node = 0; node < tree.count; node++) {
+            id key = [tree objectAtIndex:node].key;
+            if (key == nil) continue;
+            NSMutableIndexSet *nodes = _nodesByKey[key];
+            if (nodes == nil) {
+                nodes = [NSMutableIndexSet indexSet];
+                _nodesByKey[key] = nodes;
+            }
+            [nodes addIndex:node];
+        }
+        
+        /// Index the children of the root by key
+        ///     If there are several children with the same key, we keep the first one - like the linear search we used to do.
+        _topLevelValuesByKey = [NSMutableDictionary dictionary];
+        for (ArenaTreeIndex child = [tree firstChildOfNode:tree.root]; child != ArenaTreeNoNode; child = [tree nextSiblingOfNode:child]) {
+            KVPair *pair = [tree objectAtIndex:child];
+            if (pair.key != nil && _topLevelValuesByKey[pair.key] == nil) {
+                _topLevelValuesByKey[pair.key] = pair.value;
+            }
+        }
+    }
+    return self;
+}
+
+- (NSIndexSet *)nodesWithKey:(NSString *)key {
+    return _nodesByKey[key] ?: [NSIndexSet indexSet];
+}
+
+- (id)topLevelValueForKey:(NSString *)key {
+    return _topLevelValuesByKey[key];
+}
+
+- (NSIBHelpConnector *)helpConnectorWithMarker:(NSString *)marker {
+    
+    /// Note: The marker of the connector is the same NSString *instance* as the tooltip string in the decoder tree. We used to compare them with `==`, so we key this table by pointer, too.
+    
+    if (_helpConnectorsByMarker == nil) {
+        
+        _helpConnectorsByMarker = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                        valueOptions:NSPointerFunctionsStrongMemory];
+        
+        NSArray *connections = [self topLevelValueForKey:@"NSConnections"];
+        assert(connections != nil);
+        
+        for (NSIBHelpConnector *connector in connections) {
+            if (![connector isKindOfClass:[NSIBHelpConnector class]]) continue;
+            NSString *connectionMarker = [connector marker];
+            if (connectionMarker == nil) continue;
+            if ([_helpConnectorsByMarker objectForKey:connectionMarker] != nil) continue; /// Keep the first match
+            [_helpConnectorsByMarker setObject:connector forKey:connectionMarker];
+        }
+    }
+    
+    return [_helpConnectorsByMarker objectForKey:marker];
+}
+
+- (NSNibAXAttributeConnector *)accessibilityConnectorWithAttributeValue:(NSString *)attributeValue {
+    
+    if (_accessibilityConnectorsByAttributeValue == nil) {
+        
+        _accessibilityConnectorsByAttributeValue = [NSMutableDictionary dictionary];
+        
+        NSArray *accessibilityConnectors = [self topLevelValueForKey:@"NSAccessibilityConnectors"];
+        assert(accessibilityConnectors != nil);
+        
+        for (id connector in accessibilityConnectors) {
+            if (![connector isKindOfClass:[NSNibAXAttributeConnector class]]) continue;
+            NSString *value = [(NSNibAXAttributeConnector *)connector attributeValue];
+            if (value == nil) continue;
+            if (_accessibilityConnectorsByAttributeValue[value] != nil) continue; /// Keep the first match
+            _accessibilityConnectorsByAttributeValue[value] = connector;
+        }
+    }
+    
+    return _accessibilityConnectorsByAttributeValue[attributeValue];
+}
+
+- (NSWindow *)windowWithContentView:(NSView *)contentView {
+    
+    /// Sidenote: The decoderRecord doesn't seem to contain a reference to an NSWindow instance. But there's a
+    /// `NSVisibleWindows` key in the decoderRecord, which contains `NSWindowTemplate` objects. We managed to
+    /// extract a ref to the to the windows' contentView and the window's title but then we didn't pursue that approach further.
+    
+    if (_windowsByContentView == nil) {
+        
+        _windowsByContentView = [NSMapTable strongToStrongObjectsMapTable];
+        
+        NSUInteger windowCount = 0;
+        for (NSObject *object in _topLevelObjects) {
+            if (![object isKindOfClass:[NSWindow class]]) continue;
+            windowCount += 1;
+            NSView *view = [(NSWindow *)object contentView];
+            if (view == nil) continue;
+            if ([_windowsByContentView objectForKey:view] != nil) continue; /// Keep the first match
+            [_windowsByContentView setObject:object forKey:view];
+        }
+        assert(windowCount >= 1);
+    }
+    
+    return [_windowsByContentView objectForKey:contentView];
+}
+
+- (NSMenu *)mainMenu {
+    for (id topLevelObject in _topLevelObjects) {
+        if ([topLevelObject isKindOfClass:[NSMenu class]]) {
+            return topLevelObject;
+        }
+    }
+    return nil;
+}
+
+@end
+
 #pragma mark - Process DecoderRecord
 
 ///
@@ -336,11 +479,11 @@ static void postDive(NSString *nibName, NSString *fileName) {
         
         for (NSDictionary *localizationKeyData in lastLocalizationKeys) {
             unpackLocalizationKeyData(localizationKeyData, ^(NSString *localizationKey, NSString *developmentString, NSString *uiString, NSString *uiStringNibKey) {
-                NSDictionary *fromQueue = [NSLocalizedStringRecord.queue dequeue];
+                LocalizedStringRecordEntry *fromQueue = [NSLocalizedStringRecord dequeueEntry];
                 assert(fromQueue != nil);
-                assert([localizationKey isEqual:fromQueue[@"key"]]);
-                assert([developmentString isEqual:fromQueue[@"value"]]);
-                assert(YES || [@"abcdefg" isEqual: fromQueue[@"table"]]); /// Not sure if / how we could validate the table. Should be equal to the filename of the archive that we're decoding?
+                assert([localizationKey isEqual:fromQueue.key]);
+                assert([developmentString isEqual:fromQueue.value]);
+                assert(YES || [@"abcdefg" isEqual: fromQueue.table]); /// Not sure if / how we could validate the table. Should be equal to the filename of the archive that we're decoding?
             });
         }
     };
@@ -355,45 +498,69 @@ static void postDive(NSString *nibName, NSString *fileName) {
     assert(decoderRecord != nil && decoderRecord.count > 0);
     
     /// Transform decoder record into a tree
-    TreeNode<KVPair *> *treeRoot = [self treeFromDecoderRecord:decoderRecord];
-    NSArray *treeNodes = [treeRoot.depthFirstEnumerator allObjects];
+    ///     Notes:
+    ///     - The node indexes in the tree are the same as the indexes in the decoder record
+    ///     - Iterating the node indexes in order visits the tree depth-first (post-order) - which is what we used to do with `TreeNode -depthFirstEnumerator`.
+    ArenaTree<KVPair *> *tree = [self treeFromDecoderRecord:decoderRecord];
     
     /// Validate
-    assert(treeNodes.count == decoderRecord.count);
+    if (tree == nil) return; /// Malformed decoder record (`treeWithPostOrderObjects:` already asserts)
+    assert(tree.count == decoderRecord.count);
+    assert(tree.root != ArenaTreeNoNode);
     
     /// Print
-    NSLog(@"-------------------");
-    printf("%s", [[NSString stringWithFormat:@"LocStrings: SWOOOZLE, %@\n%@", topLevelObjects, treeRoot] cStringUsingEncoding:NSUTF8StringEncoding]); /// Need to use printf since NSLog truncates the output.
+    ///     Notes:
+    ///     - Need to write to stdout directly since NSLog truncates the output.
+    ///     - Dumping the tree of a big nib file takes a long time, so we only do it at high verbosity, and we cap the size of the dump.
+    if (MFVerbosityIsEnabled(MFVerbosityDebug)) {
+        NSLog(@"-------------------");
+        printf("%s\n", [[NSString stringWithFormat:@"LocStrings: SWOOOZLE, %@", topLevelObjects] UTF8String]);
+        fflush(stdout); /// Flush before writing to the file descriptor directly, so the output isn't interleaved
+        [tree writeDescriptionOfNode:tree.root toFileDescriptor:STDOUT_FILENO maxDepth:NSIntegerMax maxNodeCount:5000];
+    }
+    
+    /// Build lookup tables
+    NibDecoderTreeIndex *index = [[NibDecoderTreeIndex alloc] initWithTree:tree topLevelObjects:topLevelObjects];
     
     /// Declare state for validation
     ///     Of the following loop
-    BOOL validation_lastLocalizedStringWasNotUsed = NO;
-    TreeNode<KVPair *> *validation_lastNode = nil;
-    
-    for (TreeNode<KVPair *> *node in treeNodes) {
-        
-        /// Validate
-        assert([node.representedObject isKindOfClass:[KVPair class]]);
+    __block BOOL validation_lastLocalizedStringWasNotUsed = NO;
+    __block ArenaTreeIndex validation_lastNode = ArenaTreeNoNode;
+    void (^validateLastLocalizedStringWasUsed)(void) = ^{
         if (validation_lastLocalizedStringWasNotUsed) {
-            NSLog(@"NibAnnotation: Error: No annotation created for localized string:\n%@", validation_lastNode.parentNode.description);
+            NSLog(@"NibAnnotation: Error: No annotation created for localized string:\n%@", [tree descriptionOfNode:[tree parentOfNode:validation_lastNode]]);
             assert(false);
             validation_lastLocalizedStringWasNotUsed = NO; /// Prevent the error from being printed repeatedly for the same string
         }
+    };
+    
+    /// Only look at NSKey elements
+    ///     NSKey elements hold localizationKeys
+    ///     The index set enumerates the nodes in ascending order, so this visits them in the same depth-first order as iterating all the nodes would.
+    NSIndexSet *localizationKeyNodes = [index nodesWithKey:@"NSKey"];
+    
+    for (ArenaTreeIndex node = localizationKeyNodes.firstIndex; node != NSNotFound; node = [localizationKeyNodes indexGreaterThanIndex:node]) {
+        
+        /// Validate
+        assert([[tree objectAtIndex:node] isKindOfClass:[KVPair class]]);
+        validateLastLocalizedStringWasUsed();
         
-        /// Only look at NSKey elements
-        ///     NSKey elements hold localizationKeys
-        if (![node.representedObject.key isEqual: @"NSKey"]) continue;
+        KVPair *nodePair = [tree objectAtIndex:node];
+        assert([nodePair.key isEqual: @"NSKey"]);
         
         /// Set validation state
         validation_lastLocalizedStringWasNotUsed = YES;
         validation_lastNode = node;
         
         /// Gather values
-        NSString *localizationKey = node.representedObject.value;
-        NSString *developmentString = node.siblings[1].representedObject.value;
-        NSString *developmentStringNibKey = node.siblings[1].representedObject.key;
-        NSString *uiString = node.parentNode.representedObject.value;
-        NSString *uiStringNibKey = node.parentNode.representedObject.key;
+        ArenaTreeIndex parentNode = [tree parentOfNode:node];
+        KVPair *developmentStringPair = [tree objectAtIndex:[tree childAtIndex:1 ofNode:parentNode]]; /// The second sibling of the NSKey node
+        KVPair *parentPair = [tree objectAtIndex:parentNode];
+        NSString *localizationKey = nodePair.value;
+        NSString *developmentString = developmentStringPair.value;
+        NSString *developmentStringNibKey = developmentStringPair.key;
+        NSString *uiString = parentPair.value;
+        NSString *uiStringNibKey = parentPair.key;
         
         /// Validate
         assert([developmentStringNibKey isEqual:@"NSDev"]);
@@ -417,34 +584,9 @@ static void postDive(NSString *nibName, NSString *fileName) {
             /// Note:
             ///     The NSMarker key appears for tooltip-strings. (Maybe also elsewhere but I've only seen it on tooltips)
             
-            /// Find NSConnections array
-            NSArray *connections = nil;
-            for (TreeNode<KVPair *> *topLevelNode in treeRoot.childNodes) {
-                if ([topLevelNode.representedObject.key isEqual:@"NSConnections"]) {
-                    connections = topLevelNode.representedObject.value;
-                    break;
-                }
-            }
-            assert(connections != nil);
-                
-            
-            /// Find help-connections
-            NSMutableArray <NSIBHelpConnector *>*helpConnections = [NSMutableArray array];
-            for (NSIBHelpConnector *connection in connections) {
-                if ([connection isKindOfClass:[NSIBHelpConnector class]]) {
-                    [helpConnections addObject:connection];
-                }
-            }
-            
             /// Find help connector for our localizedString
-            NSIBHelpConnector *matchingConnector = nil;
-            for (NSIBHelpConnector *connector in helpConnections) {
-                NSString *connectionMarker = [connector marker];
-                if (connectionMarker == uiString) { /// Note that were using == so we're checking pointer-level equality on an NSString
-                    matchingConnector = connector;
-                    break;
-                }
-            }
+            ///     The help connectors are in the `NSConnections` array at the top level of the tree. Their `marker` is the very same NSString instance as our `uiString`.
+            NSIBHelpConnector *matchingConnector = [index helpConnectorWithMarker:uiString];
             assert(matchingConnector != nil);
             
             /// Extract info from matchingConnector
@@ -476,27 +618,9 @@ static void postDive(NSString *nibName, NSString *fileName) {
             ///     IB and are localizable.
             ///     We might be going overboard with this.
             
-            /// Find NSAccessibilityConnectors
-            NSArray *accessibilityConnectors = nil;
-            for (TreeNode<KVPair *> *topLevelNode in treeRoot.childNodes) {
-                if ([topLevelNode.representedObject.key isEqual:@"NSAccessibilityConnectors"]) {
-                    accessibilityConnectors = topLevelNode.representedObject.value;
-                    break;
-                }
-            }
-            assert(accessibilityConnectors != nil);
-            
             /// Find matching connector
-            NSNibAXAttributeConnector *matchingConnector = nil;
-            for (id connector in accessibilityConnectors) {
-                if ([connector isKindOfClass:[NSNibAXAttributeConnector class]]) {
-                    NSString *attributeValue = [(NSNibAXAttributeConnector *)connector attributeValue];
-                    if ([attributeValue isEqual:uiString]) {
-                        matchingConnector = connector;
-                        break;
-                    }
-                }
-            }
+            ///     in the `NSAccessibilityConnectors` array at the top level of the tree
+            NSNibAXAttributeConnector *matchingConnector = [index accessibilityConnectorWithAttributeValue:uiString];
             assert(matchingConnector != nil);
             
             /// Get destination
@@ -523,35 +647,18 @@ static void postDive(NSString *nibName, NSString *fileName) {
             /// Find windowView
             
             NSView *windowView = nil;
-            for (TreeNode<KVPair *> *siblingNode in node.parentNode.siblingEnumeratorForward) {
-                if ([siblingNode.representedObject.key isEqual:@"NSWindowView"]) {
-                    windowView = siblingNode.representedObject.value;
+            ArenaTreeCursor siblingCursor = ArenaTreeCursorMake(tree, parentNode, MFTreeTraversalSiblingsForward);
+            for (ArenaTreeIndex siblingNode = ArenaTreeCursorNext(&siblingCursor); siblingNode != ArenaTreeNoNode; siblingNode = ArenaTreeCursorNext(&siblingCursor)) {
+                if ([[tree objectAtIndex:siblingNode].key isEqual:@"NSWindowView"]) {
+                    windowView = [tree objectAtIndex:siblingNode].value;
                     break;
                 }
             }
             assert(windowView != nil);
             
-            /// Find windows in topLevelObjects
-            ///     Sidenote: The decoderRecord doesn't seem to contain a reference to an NSWindow instance. But there's a
-            ///     `NSVisibleWindows` key in the decoderRecord, which contains `NSWindowTemplate` objects. We managed to
-            ///     extract a ref to the to the windows' contentView and the window's title but then we didn't pursue that approach further.
-            
-            NSMutableArray *windows = [NSMutableArray array];
-            for (NSObject *object in topLevelObjects) {
-                if ([object isKindOfClass:[NSWindow class]]) {
-                    [windows addObject:object];
-                }
-            }
-            assert(windows.count >= 1);
-            
             /// Find window for windowView
-            NSWindow *matchingWindow = nil;
-            for (NSWindow *window in windows) {
-                if ([window.contentView isEqual:windowView]) {
-                    matchingWindow = window;
-                    break;
-                }
-            }
+            ///     in the topLevelObjects
+            NSWindow *matchingWindow = [index windowWithContentView:windowView];
             
             /// Annotate the window
             NSAccessibilityElement *annotation = [AnnotationUtility createAnnotationElementWithLocalizationKey:localizationKey translatedString:uiString developmentString:developmentString translatedStringNibKey:uiStringNibKey mergedUIString:nil];
@@ -568,9 +675,10 @@ static void postDive(NSString *nibName, NSString *fileName) {
             
             /// Find NSTableColumns in parents.
             NSArray <NSTableColumn *>* tableColumns = nil;
-            for (TreeNode<KVPair *> *parentNode in node.parentEnumerator) {
-                if ([parentNode.representedObject.key isEqual:@"NSTableColumns"]) {
-                    tableColumns = parentNode.representedObject.value;
+            ArenaTreeCursor ancestorCursor = ArenaTreeCursorMake(tree, node, MFTreeTraversalParents);
+            for (ArenaTreeIndex ancestorNode = ArenaTreeCursorNext(&ancestorCursor); ancestorNode != ArenaTreeNoNode; ancestorNode = ArenaTreeCursorNext(&ancestorCursor)) {
+                if ([[tree objectAtIndex:ancestorNode].key isEqual:@"NSTableColumns"]) {
+                    tableColumns = [tree objectAtIndex:ancestorNode].value;
                     break;
                 }
             }
@@ -603,22 +711,19 @@ static void postDive(NSString *nibName, NSString *fileName) {
             /// -> Iterate closeby nodes and attach to first adequate node we find.
             
             /// Search
-            for (TreeNode<KVPair *> *relatedNode in node.parentEnumerator) { /// Search parents
+            ArenaTreeCursor relatedCursor = ArenaTreeCursorMake(tree, node, MFTreeTraversalParents);
+            for (ArenaTreeIndex relatedNodeIndex = ArenaTreeCursorNext(&relatedCursor); relatedNodeIndex != ArenaTreeNoNode; relatedNodeIndex = ArenaTreeCursorNext(&relatedCursor)) { /// Search parents
+                
+                KVPair *relatedNode = [tree objectAtIndex:relatedNodeIndex];
                 
-                if ([relatedNode.representedObject.key isEqual:@"NSObjectsKeys"]) {
+                if ([relatedNode.key isEqual:@"NSObjectsKeys"]) {
                     
                     /// Special case: NSObjectsKeys
                     /// -> If we find `NSObjectsKeys`, then the `uiString` seems to be the title of the NSMenu for our applications' menuBar.
                     ///     I don't understand why this works, I hope it's robust.
                     
                     /// Find main menu
-                    NSMenu *mainMenu = nil;
-                    for (id topLevelObject in topLevelObjects) {
-                        if ([topLevelObject isKindOfClass:[NSMenu class]]) {
-                            mainMenu = topLevelObject;
-                            break;
-                        }
-                    }
+                    NSMenu *mainMenu = [index mainMenu];
                     assert(mainMenu != nil);
                     
                     /// Attach to mainMenu
@@ -636,10 +741,10 @@ static void postDive(NSString *nibName, NSString *fileName) {
                 
                 /// Special case: NSTabViewItems
                 
-                if ([relatedNode.representedObject.key isEqual:@"NSTabViewItems"]) {
+                if ([relatedNode.key isEqual:@"NSTabViewItems"]) {
                     
                     NSTabViewItem *matchingItem = nil;
-                    for (NSTabViewItem *item in relatedNode.representedObject.value) {
+                    for (NSTabViewItem *item in relatedNode.value) {
                         if ([item.label isEqual:uiString] || [item.toolTip isEqual:uiString]) {
                             matchingItem = item;
                             break;
@@ -660,9 +765,9 @@ static void postDive(NSString *nibName, NSString *fileName) {
                 
                 /// Special case: NSToolbar
                 
-                if ([relatedNode.representedObject.value isKindOfClass:[NSToolbar class]]) {
+                if ([relatedNode.value isKindOfClass:[NSToolbar class]]) {
                     
-                    NSToolbar *toolbar = relatedNode.representedObject.value;
+                    NSToolbar *toolbar = relatedNode.value;
                     
                     /// Find item to annotate
                     NSToolbarItemViewer *matchingAXItem = nil;
@@ -691,17 +796,17 @@ static void postDive(NSString *nibName, NSString *fileName) {
                 ///         (Or the `uiString` is the title of the `NSMenu` itself.)
                 
                 /// Check isMenu
-                BOOL isNSMenu = [relatedNode.representedObject.value isKindOfClass:[NSMenu class]];
-                BOOL isNSMenuItemsArray = [relatedNode.representedObject.key isEqual:@"NSMenuItems"];
+                BOOL isNSMenu = [relatedNode.value isKindOfClass:[NSMenu class]];
+                BOOL isNSMenuItemsArray = [relatedNode.key isEqual:@"NSMenuItems"];
                 
                 if (isNSMenu || isNSMenuItemsArray) {
                     
                     /// Get itemArray
                     NSArray<NSMenuItem *> *items = nil;
                     if (isNSMenu) {
-                        items = [(NSMenu *)relatedNode.representedObject.value itemArray];
+                        items = [(NSMenu *)relatedNode.value itemArray];
                     } else if (isNSMenuItemsArray) {
-                        items = relatedNode.representedObject.value;
+                        items = relatedNode.value;
                     }
                     
                     /// Find item to annotate
@@ -739,7 +844,7 @@ static void postDive(NSString *nibName, NSString *fileName) {
                         ///     So this case will always hit for the NSMenuTitle afaik.
                         /// - I think this might fail in a subtle way if the NSMenuTitle is the same as the title for one of its items.
                         ///     Then we might associate the NSMenuTitle localizationKey with the NSMenuItem instead.
-                        [AnnotationUtility addAnnotations:@[annotationElement] toAccessibilityElement:relatedNode.representedObject.value];
+                        [AnnotationUtility addAnnotations:@[annotationElement] toAccessibilityElement:relatedNode.value];
                     }
                     
                     /// Flag
@@ -752,8 +857,8 @@ static void postDive(NSString *nibName, NSString *fileName) {
                 
                 /// Check isAccessibilityElement
                 BOOL isAccessibilityElement = NO;
-                if ([relatedNode.representedObject.value respondsToSelector:@selector(isAccessibilityElement)]) {
-                    isAccessibilityElement = [relatedNode.representedObject.value isAccessibilityElement];
+                if ([relatedNode.value respondsToSelector:@selector(isAccessibilityElement)]) {
+                    isAccessibilityElement = [relatedNode.value isAccessibilityElement];
                 }
                 
                 if (isAccessibilityElement) {
@@ -773,7 +878,7 @@ static void postDive(NSString *nibName, NSString *fileName) {
                     /// Attach annotation
                     NSAccessibilityElement *annotation =
                     [AnnotationUtility createAnnotationElementWithLocalizationKey:localizationKey translatedString:uiString developmentString:developmentString translatedStringNibKey:uiStringNibKey mergedUIString:nil];
-                    [AnnotationUtility addAnnotations:@[annotation] toAccessibilityElement:relatedNode.representedObject.value];
+                    [AnnotationUtility addAnnotations:@[annotation] toAccessibilityElement:relatedNode.value];
                     
                     /// Flag
                     validation_lastLocalizedStringWasNotUsed = NO;
@@ -783,71 +888,36 @@ static void postDive(NSString *nibName, NSString *fileName) {
             }
         }
     }
+    
+    /// Validate the last localized string
+    ///     The loop only validates a string when it reaches the next one.
+    validateLastLocalizedStringWasUsed();
 }
 
-+ (TreeNode *)treeFromDecoderRecord:(NSArray *)decoderRecord {
-    
-    /// Declare state
++ (ArenaTree<KVPair *> *_Nullable)treeFromDecoderRecord:(NSArray *)decoderRecord {
     
-    TreeNode *root = nil;
-    TreeNode *lastNode = nil;
-    NSInteger lastDepth = -1;
+    /// Notes:
+    /// - The decoder record lists each decoded object after all of its children (post-order), along with its depth. That's exactly what `ArenaTree` builds from.
+    /// - We used to build a `TreeNode` tree here by iterating the record in reverse and walking up the parents of the last node to find the parent of each new node. `ArenaTree` does the same in O(n) and without allocating a node object per entry.
     
-    /// Build tree
+    /// Extract values
+    NSInteger count = decoderRecord.count;
+    NSMutableArray<KVPair *> *pairs = [NSMutableArray arrayWithCapacity:count];
+    NSInteger *depths = malloc(MAX(count, 1) * sizeof(NSInteger));
     
-    for (NSDictionary *kvPair in [decoderRecord reverseObjectEnumerator]) {
-        
-        /// Extract values
-        NSString *key = kvPair[@"key"];
-        NSString *value = kvPair[@"value"];
-        NSInteger depth = [kvPair[@"depth"] integerValue];
-        
-        /// Create node
-        TreeNode *node = [TreeNode treeNodeWithRepresentedObject:[KVPair pairWithKey:key value:value]];
-        
-        /// Init
-        if (depth == 0) {
-            root = node;
-            lastNode = node;
-            lastDepth = 0;
-            continue;
-        }
-        
-        /// Find parent
-        TreeNode *parent;
-        
-        NSInteger parentDepth = depth - 1;
-        NSInteger distanceFromLastNodeToParentNode = lastDepth - parentDepth;
-        
-        if (distanceFromLastNodeToParentNode == 0) {
-            parent = lastNode;
-        } else {
-            parent = lastNode;
-            for (int i = 0; i < distanceFromLastNodeToParentNode; i++) {
-                parent = parent.parentNode;
-            }
-        }
-
-        /// Validate
-        assert(distanceFromLastNodeToParentNode >= 0);
-        assert(parent != nil);
-        
-        /// Attach child
-        ///     Note: We're inserting at index one, flipping the order of the children, so they end up chronological in the order they
-        ///     were decoded. This is necessary since we're reversing the order of the decoderRecord using `reverseObjectEnumerator`
-        ///     Too lazy to explain properly.
-        [parent.mutableChildNodes insertObject:node atIndex:0];
-        
-        /// Validate
-        assert(node.indexPath.length == depth);
-        
-        /// Update state
-        lastNode = node;
-        lastDepth = depth;
+    NSInteger i = 0;
+    for (NSDictionary *kvPair in decoderRecord) {
+        [pairs addObject:[KVPair pairWithKey:kvPair[@"key"] value:kvPair[@"value"]]];
+        depths[i] = [kvPair[@"depth"] integerValue];
+        i++;
     }
     
+    /// Build tree
+    ArenaTree<KVPair *> *tree = [ArenaTree treeWithPostOrderObjects:pairs depths:depths];
+    free(depths);
+    
     /// Return
-    return root;
+    return tree;
 }
 
 @end
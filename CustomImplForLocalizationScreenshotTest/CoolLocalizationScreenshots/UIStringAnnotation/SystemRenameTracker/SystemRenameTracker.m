@@ -18,19 +18,14 @@
 
 #pragma mark - RenameDepth definitions
 
-#define MFSystemRenameDepthKey @"MFSystemRenameDepth"
-
 NSInteger MFSystemRenameDepth(void) {
-    return [NSThread.currentThread.threadDictionary[MFSystemRenameDepthKey] integerValue];
+    return MFThreadCounterGet(MFThreadCounterSystemRename);
 }
 static void MFSystemRenameDepthIncrement(void) {
-    NSInteger d = MFSystemRenameDepth() + 1;
-    NSThread.currentThread.threadDictionary[MFSystemRenameDepthKey] = @(d);
+    MFThreadCounterIncrement(MFThreadCounterSystemRename);
 }
 static void MFSystemRenameDepthDecrement(void) {
-    NSInteger d = MFSystemRenameDepth() - 1;
-    assert(d >= 0);
-    NSThread.currentThread.threadDictionary[MFSystemRenameDepthKey] = @(d);
+    MFThreadCounterDecrement(MFThreadCounterSystemRename);
 }
 
 BOOL MFSystemIsChangingUIStrings(void) {
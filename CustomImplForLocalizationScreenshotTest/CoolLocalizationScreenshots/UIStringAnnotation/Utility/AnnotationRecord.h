@@ -0,0 +1,76 @@
+//
+//  AnnotationRecord.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+/// Explanation:
+/// The data that an annotation element carries - which localized string was used to compose a uiString.
+/// We used to store an NSDictionary plus its `debugDescription` on every annotation, just so it's readable in Accessibility Inspector. Now the accessibilityValue is a compact string that's fast to write
+/// and to parse on the XCUI side, and the readable label and valueDescription are only generated when someone asks for them. (See `AnnotationElement`)
+///
+/// Serialized form:
+///     `MFA1` (magic + format version) followed by each field in the order of `AnnotationRecordField`.
+///     A field is either `-` if it's nil, or `<length>:<string>`, where length is the number of UTF-16 units of the string in decimal.
+///     Example: `MFA18:greeting5:Hallo5:Hello------` (key `greeting`, string `Hallo`, devString `Hello`, all other fields nil)
+///     Notes:
+///     - The format can be extended by appending fields. Decoders ignore fields they don't know, so that doesn't need a new version. Changing or removing fields does.
+///     - We use a string instead of binary data, since strings are passed through the accessibility API without problems.
+
+#import <Foundation/Foundation.h>
+#import <AppKit/AppKit.h>
+#import "NSLocalizedStringRecord.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, AnnotationRecordField) {
+    AnnotationRecordFieldKey = 0,
+    AnnotationRecordFieldString,
+    AnnotationRecordFieldDevString,
+    AnnotationRecordFieldNibKey,
+    AnnotationRecordFieldMergedUIString,
+    AnnotationRecordFieldSystemKey,         /// The `...System...` fields describe the system-defined localized string that probably overrode the uiString. (See `_addAnnotations:`)
+    AnnotationRecordFieldSystemValue,
+    AnnotationRecordFieldSystemTable,
+    AnnotationRecordFieldSystemResult,
+    kAnnotationRecordFieldCount,
+};
+
+@interface AnnotationRecord : NSObject
+
+@property (nonatomic, copy) NSString *key;
+@property (nonatomic, copy) NSString *string;                           /// The translated string, exactly as it was returned by NSLocalizedString()
+@property (nonatomic, copy, nullable) NSString *devString;
+@property (nonatomic, copy, nullable) NSString *nibKey;                 /// Only set for nib annotations
+@property (nonatomic, copy, nullable) NSString *mergedUIString;         /// Only set if the translated string was modified before being set on the UI element
+@property (nonatomic, strong, nullable) LocalizedStringRecordEntry *probablyOverridenBySystemEntry;
+
+- (NSString *)uiString; /// The uiString that the annotation describes. `mergedUIString` if it's set, otherwise `string`.
+
+/// Serialization
+- (NSString *)serializedString;
++ (AnnotationRecord *_Nullable)recordWithSerializedString:(NSString *)serializedString; /// Returns nil if the string is malformed or has an unknown version
+
+/// Description
+- (NSString *)description;
+
+@end
+
+/// AnnotationElement
+///     The accessibility element that holds an AnnotationRecord.
+///     - The `accessibilityValue` is the record's serialized string. Set it again after modifying the record through `-recordDidChange`.
+///     - The `accessibilityLabel` and `accessibilityValueDescription` are generated from the record when they are requested. (These show up in Accessibility Inspector.)
+
+@interface AnnotationElement : NSAccessibilityElement
+
+@property (nonatomic, strong, readonly) AnnotationRecord *record;
+
+- (instancetype)initWithRecord:(AnnotationRecord *)record;
+- (void)recordDidChange;
+
+@end
+
+AnnotationRecord *_Nullable getAnnotationRecord(NSAccessibilityElement *element); /// Works with `AnnotationElement`s and with any element whose accessibilityValue is a serialized record
+
+NS_ASSUME_NONNULL_END
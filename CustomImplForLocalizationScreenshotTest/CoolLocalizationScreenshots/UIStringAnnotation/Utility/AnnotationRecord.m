@@ -0,0 +1,172 @@
+//
+//  AnnotationRecord.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+#import "AnnotationRecord.h"
+
+static NSString *const kMagic = @"MFA1";
+
+@implementation AnnotationRecord
+
+- (NSString *)uiString {
+    return self.mergedUIString.length > 0 ? self.mergedUIString : self.string;
+}
+
+#pragma mark - Fields
+
+- (NSString *_Nullable)valueForField:(AnnotationRecordField)field {
+    switch (field) {
+        case AnnotationRecordFieldKey:              return _key;
+        case AnnotationRecordFieldString:           return _string;
+        case AnnotationRecordFieldDevString:        return _devString;
+        case AnnotationRecordFieldNibKey:           return _nibKey;
+        case AnnotationRecordFieldMergedUIString:   return _mergedUIString;
+        case AnnotationRecordFieldSystemKey:        return _probablyOverridenBySystemEntry.key;
+        case AnnotationRecordFieldSystemValue:      return _probablyOverridenBySystemEntry.value;
+        case AnnotationRecordFieldSystemTable:      return _probablyOverridenBySystemEntry.table;
+        case AnnotationRecordFieldSystemResult:     return _probablyOverridenBySystemEntry.result;
+        case kAnnotationRecordFieldCount:           break;
+    }
+    assert(false);
+    return nil;
+}
+
+#pragma mark - Serialization
+
+- (NSString *)serializedString {
+    
+    NSMutableString *result = [NSMutableString stringWithString:kMagic];
+    for (AnnotationRecordField field = 0; field < kAnnotationRecordFieldCount; field++) {
+        NSString *value = [self valueForField:field];
+        if (value == nil) {
+            [result appendString:@"-"];
+        } else {
+            [result appendFormat:@"%lu:%@", (unsigned long)value.length, value];
+        }
+    }
+    return result;
+}
+
++ (AnnotationRecord *)recordWithSerializedString:(NSString *)serializedString {
+    
+    /// Validate magic
+    if (![serializedString isKindOfClass:[NSString class]] || ![serializedString hasPrefix:kMagic]) {
+        return nil;
+    }
+    
+    /// Parse fields
+    ///     Note: We parse the length manually instead of using NSScanner, since this runs for every annotation on the XCUI side.
+    NSString *fields[kAnnotationRecordFieldCount] = { nil };
+    NSUInteger length = serializedString.length;
+    NSUInteger i = kMagic.length;
+    for (AnnotationRecordField field = 0; field < kAnnotationRecordFieldCount; field++) {
+        
+        if (i >= length) return nil; /// Missing field
+        
+        /// Nil field
+        unichar c = [serializedString characterAtIndex:i];
+        if (c == '-') {
+            i++;
+            continue;
+        }
+        
+        /// Parse length
+        NSUInteger fieldLength = 0;
+        NSUInteger digitCount = 0;
+        while (i < length && (c = [serializedString characterAtIndex:i]) >= '0' && c <= '9') {
+            if (fieldLength > (NSUIntegerMax - 9) / 10) return nil; /// Overflow
+            fieldLength = fieldLength * 10 + (c - '0');
+            digitCount++;
+            i++;
+        }
+        if (digitCount == 0 || i >= length || c != ':') return nil;
+        if (digitCount > 1 && [serializedString characterAtIndex:i - digitCount] == '0') return nil; /// Leading zeros - only accept the canonical form, so each record has exactly one serialized form
+        i++;
+        
+        /// Extract string
+        if (length - i < fieldLength) return nil;
+        fields[field] = [serializedString substringWithRange:NSMakeRange(i, fieldLength)];
+        i += fieldLength;
+    }
+    /// Note: Ignore anything after the known fields (See the format notes in the header)
+    
+    /// Validate required fields
+    if (fields[AnnotationRecordFieldKey] == nil || fields[AnnotationRecordFieldString] == nil) {
+        return nil;
+    }
+    
+    /// Create record
+    AnnotationRecord *record = [[AnnotationRecord alloc] init];
+    record.key = fields[AnnotationRecordFieldKey];
+    record.string = fields[AnnotationRecordFieldString];
+    record.devString = fields[AnnotationRecordFieldDevString];
+    record.nibKey = fields[AnnotationRecordFieldNibKey];
+    record.mergedUIString = fields[AnnotationRecordFieldMergedUIString];
+    if (fields[AnnotationRecordFieldSystemKey] != nil) {
+        record.probablyOverridenBySystemEntry = [[LocalizedStringRecordEntry alloc] initWithKey:fields[AnnotationRecordFieldSystemKey]
+                                                                                          value:fields[AnnotationRecordFieldSystemValue]
+                                                                                          table:fields[AnnotationRecordFieldSystemTable]
+                                                                                         result:fields[AnnotationRecordFieldSystemResult]]; /// Not interned - we decode lots of records on the XCUI side, and the intern pool is never cleared
+    }
+    
+    return record;
+}
+
+#pragma mark - Description
+
+- (NSString *)description {
+    
+    /// Notes:
+    /// - Single-line since Accessibility Inspector shows the valueDescription in a single-line field.
+    
+    NSMutableString *result = [NSMutableString stringWithFormat:@"{ key: \"%@\", string: \"%@\"", _key, _string];
+    if (_devString != nil)          [result appendFormat:@", devString: \"%@\"", _devString];
+    if (_nibKey != nil)             [result appendFormat:@", nibKey: \"%@\"", _nibKey];
+    if (_mergedUIString != nil)     [result appendFormat:@", mergedUIString: \"%@\"", _mergedUIString];
+    if (_probablyOverridenBySystemEntry != nil) {
+        [result appendFormat:@", probablyOverridenBySystemString: { key: \"%@\", table: \"%@\", result: \"%@\" }", _probablyOverridenBySystemEntry.key, _probablyOverridenBySystemEntry.table, _probablyOverridenBySystemEntry.result];
+    }
+    [result appendString:@" }"];
+    
+    return [result stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
+}
+
+@end
+
+@implementation AnnotationElement
+
+- (instancetype)initWithRecord:(AnnotationRecord *)record {
+    self = [super init];
+    if (self) {
+        _record = record;
+        [self recordDidChange];
+    }
+    return self;
+}
+
+- (void)recordDidChange {
+    [self setAccessibilityValue:[_record serializedString]];
+}
+
+/// Lazy debug strings
+///     Only Accessibility Inspector looks at these, so we don't generate them up front.
+
+- (NSString *)accessibilityLabel {
+    return [NSString stringWithFormat:@"%@=%@", _record.key, _record.string];
+}
+
+- (NSString *)accessibilityValueDescription {
+    return [_record description];
+}
+
+@end
+
+AnnotationRecord *getAnnotationRecord(NSAccessibilityElement *element) {
+    if ([element isKindOfClass:[AnnotationElement class]]) {
+        return [(AnnotationElement *)element record];
+    }
+    return [AnnotationRecord recordWithSerializedString:[element accessibilityValue]];
+}
@@ -15,7 +15,9 @@ NS_ASSUME_NONNULL_BEGIN
 NSString *annotationDescription(NSAccessibilityElement *element);
 
 + (BOOL)accessibilityElement:(NSObject *)object containsUIString:(NSString *)uiString;
++ (NSSet<NSString *> *)uiStringsOnAccessibilityElement:(NSObject<NSAccessibility> *)object;
 + (BOOL)additionalUIStringHolder:(NSObject *)object containsUIString:(NSString *)uiString;
++ (NSSet<NSString *> *)uiStringsOnAdditionalUIStringHolder:(NSObject *)object;
 
 NSDictionary<NSString *, NSString *> *getUIStringsFromAdditionalUIStringHolder(NSObject *object);
 NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAccessibility> *element);
@@ -28,6 +30,7 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
 
 + (void)addAnnotations:(NSArray<NSAccessibilityElement *>*)annotations toAccessibilityElement:(NSObject<NSAccessibility>*)object withAdditionalUIStringHolder:(NSObject *)additionalUIStringHolder;
 + (void)addAnnotations:(NSArray<NSAccessibilityElement *>*)newChildren toAccessibilityElement:(id<NSAccessibility>)parent;
++ (void)commitPendingAnnotations; /// Annotations are buffered and added to the accessibilityChildren once per runLoop iteration. Call this to add them right away.
 
 #pragma mark - Utility
 
@@ -37,6 +40,7 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
 #pragma mark - LocalizedString Processing
 
 BOOL stringHasOnlyLocaleSharedContent(NSString *string);
+BOOL uiStringMightContainLocalizedString(NSString *uiString, NSString *localizedString);
 NSString *uiStringByRemovingLocalizedString(NSString *uiString, NSString *localizedString);
 NSString *removeMarkdownFormatting(NSString* input);
 NSString *pureString(id value);
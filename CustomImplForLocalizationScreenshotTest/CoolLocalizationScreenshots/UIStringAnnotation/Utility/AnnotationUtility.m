@@ -17,9 +17,12 @@
 #import "AnnotationUtility.h"
 #import "UINibDecoderIntrospection.h"
 #import "NSLocalizedStringRecord.h"
+#import "LocalizedStringReverseIndex.h"
+#import "AnnotationRecord.h"
 #import "Utility.h"
 #import "NSString+Additions.h"
 #import "objc/runtime.h"
+#import "objc/message.h"
 #import "AppKitIntrospection.h"
 
 @implementation AnnotationUtility
@@ -76,57 +79,37 @@
         assert(mergedUIString == nil);
     }
     
+    /// Create record
+    AnnotationRecord *record = [[AnnotationRecord alloc] init];
+    record.key = localizationKey;
+    record.string = translatedString;
+    record.devString = developmentString;
+    record.nibKey = translatedStringNibKey;
+    record.mergedUIString = mergedUIString;
+    
     /// Create & init element
-    NSAccessibilityElement *element = [[NSAccessibilityElement alloc] init];
+    ///     Note: The label and valueDescription (which we used to set here for Accessibility Inspector) are now generated lazily by the AnnotationElement. See AnnotationRecord.h.
+    AnnotationElement *element = [[AnnotationElement alloc] initWithRecord:record];
     [element setAccessibilityEnabled:YES/*NO*/];
     [element setAccessibilityRole:isCodeAnnotation ? @"MFCodeLocalizationKeyRole" : @"MFNibLocalizationKeyRole"];
     
-    /// Set value
-    [element setAccessibilityValue:@{
-        @"key": localizationKey,
-        @"string": translatedString,
-        @"devString": developmentString ?: NSNull.null,
-        @"nibKey": translatedStringNibKey ?: NSNull.null,
-        @"mergedUIString": mergedUIString ?: NSNull.null,
-    }];
-    
-    /// Store debug data
-    ///     These values will be visible to us in Accessibility Inspector
-    ///     We set the `valueDescription` because the actual `value` field will show up as `Empty` in Accessibility Inspector if we set it to a Dictionary.
-    ///     If this doesn't work we could also JSON encode the dict.
-    
-    /// Set label
-    NSString *label = [@[localizationKey, translatedString] componentsJoinedByString:@"="];
-    [element setAccessibilityLabel:label];
-    
-    /// Set value description
-    NSString *valueDescription = [[[element accessibilityValue] debugDescription] stringByReplacingOccurrencesOfString:@"\n" withString:@""];
-    [element setAccessibilityValueDescription:valueDescription];
-    
     /// Return
     return element;
 };
 
 
-+ (void)extendAnnotationElement:(NSAccessibilityElement *)element withEntriesOfDict:(NSDictionary *)extension {
++ (void)extendAnnotationElement:(NSAccessibilityElement *)element withProbablyOverridenBySystemEntry:(LocalizedStringRecordEntry *)entry {
     
     /// Get
-    NSMutableDictionary *dict = [(NSDictionary *)[element accessibilityValue] mutableCopy];
+    assert([element isKindOfClass:[AnnotationElement class]]);
+    AnnotationElement *annotationElement = (AnnotationElement *)element;
     
     /// Validate
-    BOOL overlappingKeys = [[NSSet setWithArray:dict.allKeys] intersectsSet:[NSSet setWithArray:extension.allKeys]];
-    assert(!overlappingKeys);
+    assert(annotationElement.record.probablyOverridenBySystemEntry == nil);
     
     /// Extend
-    [dict addEntriesFromDictionary:extension];
-    
-    /// Set value
-    [element setAccessibilityValue:dict];
-    
-    /// Set value description
-    NSString *valueDescription = [[[element accessibilityValue] debugDescription] stringByReplacingOccurrencesOfString:@"\n" withString:@""];
-    [element setAccessibilityValueDescription:valueDescription];
-    
+    annotationElement.record.probablyOverridenBySystemEntry = entry;
+    [annotationElement recordDidChange];
 }
 
 + (void)addAnnotations:(NSArray<NSAccessibilityElement *>*)annotations toAccessibilityElement:(NSObject<NSAccessibility>*)object {
@@ -150,6 +133,17 @@
         [annotation setAccessibilityParent:element];
     }
     
+    /// Extract uiStrings
+    ///     We extract the uiStrings from the element (and the additionalUIStringHolder) only once and then validate all the annotations against them. (Instead of re-extracting them for each annotation)
+    NSSet<NSString *> *uiStringsOnElement = nil;
+    NSSet<NSString *> *uiStringsOnAdditionalHolder = nil;
+    if (!forceValidation) {
+        uiStringsOnElement = [self uiStringsOnAccessibilityElement:element];
+        if (additionalUIStringHolder != nil) {
+            uiStringsOnAdditionalHolder = [self uiStringsOnAdditionalUIStringHolder:additionalUIStringHolder];
+        }
+    }
+    
     /// Validation
     for (NSAccessibilityElement *annotation in annotations) {
         
@@ -163,7 +157,10 @@
         } else {
             
             /// Main Check - accessibilityElement
-            annotationMatchesObject = [self annotationElement:annotation describesSomeUIStringOnAccessibilityElement:element additionalUIStringHolder:additionalUIStringHolder];
+            ///     (Does the same as `annotationElement:describesSomeUIStringOnAccessibilityElement:additionalUIStringHolder:` but with the pre-extracted uiStrings)
+            NSString *uiStringFromAnnotation = getUIStringFromAnnotation(annotation);
+            assert(uiStringFromAnnotation.length > 0);
+            annotationMatchesObject = [uiStringsOnElement containsObject:uiStringFromAnnotation] || [uiStringsOnAdditionalHolder containsObject:uiStringFromAnnotation];
             
             /// Fallback check - `_menuItemsRenamedBySystem`
             if (!annotationMatchesObject) {
@@ -178,23 +175,23 @@
                 ///     (annotationMatchesObject is false) then we check if the NSLocalizedStringRecord has recorded any string retrievals from system-defined stringTables,
                 ///     where the retrieved UI string matches any uiString of the object we're inspecting right now. If yes, then we let this annotation pass.
                 ///
-                ///     Update: We now added `_menuItemsRenamedBySystem` which could replace this validation logic, and probably make NSLocalizedStringRecord.systemSet
-                ///     and NSLocalizedStringRecord.systemQueue obsolete (We introduced those for this specific validation code)
-                
+                ///     Update: We now added `_menuItemsRenamedBySystem` which could replace this validation logic, and probably make the system record
+                ///     of NSLocalizedStringRecord obsolete (We introduced that for this specific validation code)
+                ///
+                ///     Performance: The system record is indexed by the retrieved string, so instead of checking every recorded system string against the element,
+                ///     we look up each of the element's uiStrings in the record. (The element only has a handful of uiStrings, while the record can grow very large)
                 
-                for (NSDictionary *record in NSLocalizedStringRecord.systemSet) {
+                for (NSString *uiString in uiStringsOnElement) {
                     
-                    unpackLocalizedStringRecord(record);
+                    LocalizedStringRecordEntry *record = [NSLocalizedStringRecord systemEntryWithResult:uiString];
                     
-                    if ([self accessibilityElement:element containsUIString:m_localizedStringFromRecord] && m_localizedStringFromRecord.length > 0) {
+                    if (record != nil) {
                         uiStringWasProbablyOverridenBySystem = YES;
                     }
                     if (uiStringWasProbablyOverridenBySystem) {
                         
                         /// Extend annotation
-                        [self extendAnnotationElement:annotation withEntriesOfDict:@{
-                            @"probablyOverridenBySystemString": record,
-                        }];
+                        [self extendAnnotationElement:annotation withProbablyOverridenBySystemEntry:record];
                         
                         /// Break
                         break;
@@ -206,24 +203,86 @@
         /// Validate
         BOOL isValid = annotationMatchesObject || uiStringWasProbablyOverridenBySystem;
         if (!isValid) {
-            NSLog(@"UIStringAnnotation: Error: Annotation %@ describes a uiString that was not found on the object %@ which we wanted to attach the annotation to\n(uiStrings found on object: %@)\n. There might be a bug in the code. Sometimes this also happens because the uiString that the annotation describes isn't settable on the object.",
-                  annotationDescription(annotation), element, getUIStringsFromAXElement(element));
+            NSMutableArray *systemCandidates = [NSMutableArray array]; /// Just for debugging - if the uiString on the object comes from a system table, AppKit might have renamed it in a way we don't handle yet.
+            for (NSString *uiString in uiStringsOnElement) {
+                [systemCandidates addObjectsFromArray:[LocalizedStringReverseIndex.systemIndex candidatesForUIString:uiString]];
+            }
+            NSLog(@"UIStringAnnotation: Error: Annotation %@ describes a uiString that was not found on the object %@ which we wanted to attach the annotation to\n(uiStrings found on object: %@)\n(Candidates from the system string tables: %@)\n. There might be a bug in the code. Sometimes this also happens because the uiString that the annotation describes isn't settable on the object.",
+                  annotationDescription(annotation), element, getUIStringsFromAXElement(element), systemCandidates);
             assert(false);
         }
     }
     
-    /// Get old children
-    NSMutableArray *children = [element accessibilityChildren/*InNavigationOrder*/].mutableCopy; /// Not sure whether to use `InNavigationOrder`
-    if (children == nil) {
-        children = [NSMutableArray array];
-    }
+    /// Buffer the annotations
+    ///     They are added to the element's accessibilityChildren in `commitPendingAnnotations`.
+    [self enqueuePendingAnnotations:annotations forAccessibilityElement:element];
+};
+
+#pragma mark - Pending annotations
+
+/// Explanation:
+/// We buffer the annotations for each element and set them with a single `setAccessibilityChildren:` call before the runLoop goes to sleep.
+/// Setting them right away meant copying the element's whole accessibilityChildren array on every `_addAnnotations:` call, which got slow for menus and tables that get lots of annotations.
+///
+/// Notes:
+/// - The annotations are still validated right away in `_addAnnotations:`.
+/// - They only show up in the accessibility hierarchy once they're committed. Call `commitPendingAnnotations` if you need them right away. (The XCUI tests only look at the hierarchy when the app is idle, so they don't care.)
+
+static NSMapTable<NSObject<NSAccessibility> *, NSMutableArray<NSAccessibilityElement *> *> *_pendingAnnotations = nil;
+
++ (void)enqueuePendingAnnotations:(NSArray<NSAccessibilityElement *> *)annotations forAccessibilityElement:(NSObject<NSAccessibility> *)element {
+    
+    /// Validate thread
+    assert(NSThread.currentThread.isMainThread);
+    
+    /// Set up
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _pendingAnnotations = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory capacity:64];
+        /// Commit before the runLoop sleeps
+        ///     Note: We add the observer to the common modes instead of using `observeLoopActivities:`, since that only observes the modes that exist right now - and the event tracking mode (which runs while a menu is open) might not exist yet.
+        CFRunLoopObserverRef observer = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+            [AnnotationUtility commitPendingAnnotations];
+        });
+        CFRunLoopAddObserver(CFRunLoopGetMain(), observer, kCFRunLoopCommonModes);
+        CFRelease(observer);
+    });
+    
+    /// Buffer
+    NSMutableArray<NSAccessibilityElement *> *pending = [_pendingAnnotations objectForKey:element];
+    if (pending == nil) {
+        pending = [NSMutableArray array];
+        [_pendingAnnotations setObject:pending forKey:element];
+    }
+    [pending addObjectsFromArray:annotations];
+}
+
++ (void)commitPendingAnnotations {
     
-    ///Combine children
-    [children addObjectsFromArray:annotations];
+    /// Validate thread
+    assert(NSThread.currentThread.isMainThread);
     
-    /// Set children
-    [element setAccessibilityChildren/*InNavigationOrder*/:children.copy]; /// Not sure .copy is useful or necessary
-};
+    /// Skip
+    if (_pendingAnnotations.count == 0) return;
+    
+    /// Take the pending annotations
+    ///     Swap out the table before setting the children, in case setting them ends up adding more annotations.
+    NSMapTable<NSObject<NSAccessibility> *, NSMutableArray<NSAccessibilityElement *> *> *pendingAnnotations = _pendingAnnotations.copy;
+    [_pendingAnnotations removeAllObjects];
+    
+    /// Commit
+    for (NSObject<NSAccessibility> *element in pendingAnnotations) {
+        
+        NSArray<NSAccessibilityElement *> *annotations = [pendingAnnotations objectForKey:element];
+        
+        /// Combine children
+        NSArray *oldChildren = [element accessibilityChildren/*InNavigationOrder*/]; /// Not sure whether to use `InNavigationOrder`
+        NSArray *children = oldChildren.count > 0 ? [oldChildren arrayByAddingObjectsFromArray:annotations] : annotations.copy;
+        
+        /// Set children
+        [element setAccessibilityChildren/*InNavigationOrder*/:children];
+    }
+}
 
 
 #pragma mark - Extract UI Srings
@@ -267,6 +326,100 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAdditionalUIStringHolder(N
     return result;
 }
 
+///
+/// Extraction plans
+///     `getUIStringsFromAXElement()` is called very often, and it used to do the `isKindOfClass:` checks for the special cases every time.
+///     Those only depend on the class of the element, so we work them out once per class and cache the result in a 'plan'.
+///     Notes:
+///     - We still call all the ax getters, and we still check `respondsToSelector:` on the instance (not the class) for the tooltip and alternateTitle getters.
+///         That's because objects can answer through `respondsToSelector:` overrides or message forwarding, and classes can gain methods later (e.g. through swizzling or categories in bundles that are loaded later), and a per-class cache would miss both.
+///     - The superclass chain of a class doesn't change after it's registered, so caching the `isKindOfClass:` results can't go stale.
+///
+
+typedef struct {
+    NSAccessibilityAttributeName attributeName;
+    SEL getter;
+} AXUIStringGetter;
+
+static const AXUIStringGetter *axUIStringGetters(NSUInteger *countOut) {
+    
+    /// The ax attributes which can hold uiStrings, and the getters for retrieving them.
+    ///     Notes:
+    ///     - The order matters: The attribute names are keys of the dict returned by `getUIStringsFromAXElement()` - and the tooltip, alternateTitle etc. are written on top.
+    ///     - The `NSAccessibility...Attribute` constants aren't compile-time constants, so we can't make this a static initializer.
+    
+    static AXUIStringGetter _getters[11];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSUInteger i = 0;
+        
+        /// Localizable strings that appear visually in the UI
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityTitleAttribute,                       @selector(accessibilityTitle) };                        /// Regular UIStrings
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityValueAttribute,                       @selector(accessibilityValue) };                        /// Regular UIStrings
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityPlaceholderValueAttribute,            @selector(accessibilityPlaceholderValue) };             /// Placeholders
+        
+        /// HelpAttribute
+        ///     Localizable string that usually appears visually in the UI as a tooltip, but not always
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityHelpAttribute,                        @selector(accessibilityHelp) };                         /// Voice Over Stuff & Sometimes tooltips
+        
+        /// Localizable strings that only appear in Assistive Apps like VoiceOver
+        ///     (I might have missed some)
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityDescriptionAttribute,                 @selector(accessibilityLabel) };                        /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityValueDescriptionAttribute,            @selector(accessibilityValueDescription) };             /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityRoleDescriptionAttribute,             @selector(accessibilityRoleDescription) };              /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityHorizontalUnitDescriptionAttribute,   @selector(accessibilityHorizontalUnitDescription) };    /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityVerticalUnitDescriptionAttribute,     @selector(accessibilityVerticalUnitDescription) };      /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityMarkerTypeDescriptionAttribute,       @selector(accessibilityMarkerTypeDescription) };        /// Voice Over Stuff
+        _getters[i++] = (AXUIStringGetter){ NSAccessibilityUnitDescriptionAttribute,             @selector(accessibilityUnitDescription) };              /// Voice Over Stuff
+        //        ???:                                                    [element accessibilityUserInputLabels] ?: NSNull.null,              /// Voice Over Stuff
+        //        ???:                                                    [element accessibilityAttributedUserInputLabels] ?: NSNull.null,    /// Voice Over Stuff
+        
+        assert(i == sizeof(_getters)/sizeof(_getters[0]));
+    });
+    
+    *countOut = sizeof(_getters)/sizeof(_getters[0]);
+    return _getters;
+}
+
+typedef struct {
+    BOOL isSegmentedCell;
+    BOOL isToolbarItemViewer;
+} UIStringExtractionPlan;
+
+static UIStringExtractionPlan getUIStringExtractionPlan(Class cls) {
+    
+    /// Get cache
+    static NSMapTable *_planCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _planCache = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+    });
+    
+    /// Lookup cache
+    UIStringExtractionPlan plan = {0};
+    @synchronized (_planCache) {
+        NSValue *cached = [_planCache objectForKey:(id)cls];
+        if (cached != nil) {
+            [cached getValue:&plan size:sizeof(plan)];
+            return plan;
+        }
+    }
+    
+    /// Make plan
+    plan.isSegmentedCell = [cls isSubclassOfClass:[NSSegmentedCell class]];
+    Class toolbarItemViewerClass = objc_getClass("NSToolbarItemViewer");
+    plan.isToolbarItemViewer = toolbarItemViewerClass != nil && [cls isSubclassOfClass:toolbarItemViewerClass];
+    
+    /// Store plan
+    @synchronized (_planCache) {
+        [_planCache setObject:[NSValue valueWithBytes:&plan objCType:@encode(UIStringExtractionPlan)] forKey:(id)cls];
+    }
+    
+    /// Return
+    return plan;
+}
+
 NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAccessibility> *element) {
     
     /// Note that the returned uiStrings are purely NSStrings (not NSAttributedStrings) (and also NSNull.null instances)
@@ -275,6 +428,9 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     /// Validate
     assert([element isAccessibilityElement]);
     
+    /// Get plan
+    UIStringExtractionPlan plan = getUIStringExtractionPlan(object_getClass(element));
+    
     /// Special case: tooltip
     /// Explanation:
     ///     Tooltips are usually published through the AX API under the NSAccessibilityHelpAttribute, but not always. E.g. on NSMenuItem's
@@ -300,37 +456,27 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     }
     
     /// Get values from AX API.
+    ///     Every ax element implements these getters (they're part of the NSAccessibility protocol), so we call all of them.
     
-    NSMutableDictionary<NSString *, NSString *> *result = @{
-        
-        /// Localizable strings that appear visually in the UI
-        NSAccessibilityTitleAttribute:                          [element accessibilityTitle] ?: NSNull.null,                        /// Regular UIStrings
-        NSAccessibilityValueAttribute:                          [element accessibilityValue] ?: NSNull.null,                        /// Regular UIStrings
-        NSAccessibilityPlaceholderValueAttribute:               [element accessibilityPlaceholderValue] ?: NSNull.null,             /// Placeholders
-        @"toolTip":                                             toolTip ?: NSNull.null,                                             /// Tooltips
-        
-        /// HelpAttribute
-        ///     Localizable string that usually appears visually in the UI as a tooltip, but not always
-        NSAccessibilityHelpAttribute:                           [element accessibilityHelp] ?: NSNull.null,                         /// Voice Over Stuff & Sometimes tooltips
-        
-        /// Localizable strings that only appear in Assistive Apps like VoiceOver
-        ///     (I might have missed some)
-        NSAccessibilityDescriptionAttribute:                    [element accessibilityLabel] ?: NSNull.null,                        /// Voice Over Stuff
-        NSAccessibilityValueDescriptionAttribute:               [element accessibilityValueDescription] ?: NSNull.null,             /// Voice Over Stuff
-        NSAccessibilityRoleDescriptionAttribute:                [element accessibilityRoleDescription] ?: NSNull.null,              /// Voice Over Stuff
-        NSAccessibilityHorizontalUnitDescriptionAttribute:      [element accessibilityHorizontalUnitDescription] ?: NSNull.null,    /// Voice Over Stuff
-        NSAccessibilityVerticalUnitDescriptionAttribute:        [element accessibilityVerticalUnitDescription] ?: NSNull.null,      /// Voice Over Stuff
-        NSAccessibilityMarkerTypeDescriptionAttribute:          [element accessibilityMarkerTypeDescription] ?: NSNull.null,        /// Voice Over Stuff
-        NSAccessibilityUnitDescriptionAttribute:                [element accessibilityUnitDescription] ?: NSNull.null,              /// Voice Over Stuff
-        //        ???:                                                    [element accessibilityUserInputLabels] ?: NSNull.null,              /// Voice Over Stuff
-        //        ???:                                                    [element accessibilityAttributedUserInputLabels] ?: NSNull.null,    /// Voice Over Stuff
-    }.mutableCopy;
+    NSMutableDictionary<NSString *, NSString *> *result = [NSMutableDictionary dictionary];
+    
+    NSUInteger getterCount;
+    const AXUIStringGetter *getters = axUIStringGetters(&getterCount);
+    for (NSUInteger i = 0; i < getterCount; i++) {
+        id value = ((id (*)(id, SEL))objc_msgSend)(element, getters[i].getter);
+        if (value != nil) {
+            result[getters[i].attributeName] = value;
+        }
+    }
+    if (toolTip != nil) {
+        result[@"toolTip"] = toolTip;                                                                                                 /// Tooltips
+    }
     
     /// Special case: NSSegmentedCell
     ///     The segmented cell holds labels and tooltips for each of its segments.
     ///     The segmented cell has and accessibilityChild "mock element" for each of its segments. It would be better to attach out annotation directly to those.
     ///     (which would render this code here obsolete) But it doesn't matter that much.
-    if ([element isKindOfClass:[NSSegmentedCell class]]) {
+    if (plan.isSegmentedCell) {
         NSInteger segmentCount = [(NSSegmentedCell *)element segmentCount];
         for (int i = 0; i < segmentCount; i++) {
             NSString *label = [(NSSegmentedCell *)element labelForSegment:i];
@@ -341,7 +487,7 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     }
     
     /// Special case: NSToolbarItemViewer
-    if ([element isKindOfClass:objc_getClass("NSToolbarItemViewer")]) { /// NSToolbarItem's ax representatives are NSToolbarItemViewer instances. But for FlexibleSpaceItem, the itemViewer is not an axElement.
+    if (plan.isToolbarItemViewer) { /// NSToolbarItem's ax representatives are NSToolbarItemViewer instances. But for FlexibleSpaceItem, the itemViewer is not an axElement.
         NSToolbarItem *item = [(NSToolbarItemViewer *)element item];
         result[@"label"] = item.label;
         result[@"paletteLabel"] = item.paletteLabel;
@@ -361,7 +507,7 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
         id value = result[key];
         
         /// Strip out NSNull
-        ///     We need to use NSNull in the dict literal, but don't want to return it
+        ///     We used to put NSNull into a dict literal for missing values. Now we don't, but keep this in case a getter returns NSNull.
         BOOL isNSNull = [value isEqual:NSNull.null];
         BOOL isNSString = [value isKindOfClass:[NSString class]];
         
@@ -383,22 +529,31 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     
     /// Validate input
     assert(uiString.length > 0);
+    
+    /// Main logic
+    BOOL objectContainsUIString = [[self uiStringsOnAdditionalUIStringHolder:object] containsObject:uiString];
+    
+    return objectContainsUIString;
+}
+
++ (NSSet<NSString *> *)uiStringsOnAdditionalUIStringHolder:(NSObject *)object {
+    
+    /// Validate input
     if ([object respondsToSelector:@selector(isAccessibilityElement)] && [(id)object isAccessibilityElement]) {
         assert(false);
     }
     
     /// Main logic
-    BOOL objectContainsUIString = NO;
-    NSDictionary *uiStringsFromObject = uiStringsFromObject = getUIStringsFromAdditionalUIStringHolder(object);
+    NSMutableSet<NSString *> *result = [NSMutableSet set];
+    NSDictionary *uiStringsFromObject = getUIStringsFromAdditionalUIStringHolder(object);
     for (id uiStringFromObjectttt in uiStringsFromObject.allValues) {
         NSString *uiStringFromObject = pureString(uiStringFromObjectttt);
-        if ([uiStringFromObject isEqual:uiString] && uiStringFromObject.length > 0) {
-            objectContainsUIString = YES;
-            break;
+        if (uiStringFromObject.length > 0) {
+            [result addObject:uiStringFromObject];
         }
     }
     
-    return objectContainsUIString;
+    return result;
 }
 
 + (BOOL)accessibilityElement:(NSObject<NSAccessibility> *)object containsUIString:(NSString *)uiString {
@@ -408,13 +563,43 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     assert([object isAccessibilityElement]);
     
     /// Main logic
-    BOOL objectContainsUIString = NO;
-    NSDictionary *uiStringsFromObject = uiStringsFromObject = getUIStringsFromAXElement(object);
+    BOOL objectContainsUIString = [[self uiStringsOnAccessibilityElement:object] containsObject:uiString];
+    
+    if (NO && !objectContainsUIString) {
+        
+        /// In this code we tried to check the `accessibilityTitleUIElement` property to find the uiString, but this doesn't seem to be necessary anymore with the other special-case-code we've implemented here and in geUIStringsFromAccessibilityElement
+        
+        NSObject<NSAccessibility>*titleUIElement = [(id)object accessibilityTitleUIElement];
+        if (titleUIElement != nil) {
+            if ([titleUIElement isKindOfClass:[NSAccessibilityProxy class]]) {
+                titleUIElement = [(NSAccessibilityProxy *)titleUIElement realElement];
+            }
+            objectContainsUIString = [self accessibilityElement:titleUIElement containsUIString:uiString];
+        }
+    }
+    
+    /// Return
+    return objectContainsUIString;
+}
+
++ (NSSet<NSString *> *)uiStringsOnAccessibilityElement:(NSObject<NSAccessibility> *)object {
+    
+    /// Returns all the non-empty uiStrings that `accessibilityElement:containsUIString:` considers to be present on the element.
+    ///     That's the values of `getUIStringsFromAXElement()` plus some special cases.
+    ///     Returning a set lets callers check many strings against the element without re-extracting the uiStrings for each of them.
+    
+    /// Validate input
+    assert([object isAccessibilityElement]);
+    
+    /// Declare result
+    NSMutableSet<NSString *> *result = [NSMutableSet set];
+    
+    /// Main logic
+    NSDictionary *uiStringsFromObject = getUIStringsFromAXElement(object);
     for (NSAccessibilityAttributeName attributeName in uiStringsFromObject.allKeys) {
         NSString *uiStringFromObject = pureString(uiStringsFromObject[attributeName]);
-        if ([uiStringFromObject isEqual:uiString] && uiStringFromObject.length > 0) {
-            objectContainsUIString = YES;
-            break;
+        if (uiStringFromObject.length > 0) {
+            [result addObject:uiStringFromObject];
         }
     }
     
@@ -424,73 +609,52 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
     
     /// Shouldn't we put these special cases into `getUserFacingStringsFromAccessibilityElement:` instead?
     
-    if (!objectContainsUIString) {
-        
-        /// Special case: NSMenu
-        /// Explanation:
-        ///     NSMenus contain a localizable string: their 'title'. however the title is not actually visible in the UI, and also is not published through any accessibility attributes.
-        /// Further weirdness:
-        ///     NSMenus also link to an `accessibilityTitleUIElement` which seems to be the NSMenuItem which
-        ///     opens the menu (if the menu is a submenu) However the title of this NSMenuItem (aka the titleUIElement) can be different than the title of the NSMenu
-        ///     itself. So we can't use that to validate the `uiString`. Instead we check the 'title' property of the NSMenu, that seems to work.
-        ///     Really, we could probably  be ignoring the menu titles altogether as they seem to be unused, but Xcode does generate localizedStrings for them.
-        ///
-        
-        if ([object isKindOfClass:[NSMenu class]]) {
-            BOOL uiStringIsTitle = [[((NSMenu *)object) title] isEqual:uiString];
-            objectContainsUIString = uiStringIsTitle;
-        }
-    }
+    /// Special case: NSMenu
+    /// Explanation:
+    ///     NSMenus contain a localizable string: their 'title'. however the title is not actually visible in the UI, and also is not published through any accessibility attributes.
+    /// Further weirdness:
+    ///     NSMenus also link to an `accessibilityTitleUIElement` which seems to be the NSMenuItem which
+    ///     opens the menu (if the menu is a submenu) However the title of this NSMenuItem (aka the titleUIElement) can be different than the title of the NSMenu
+    ///     itself. So we can't use that to validate the `uiString`. Instead we check the 'title' property of the NSMenu, that seems to work.
+    ///     Really, we could probably  be ignoring the menu titles altogether as they seem to be unused, but Xcode does generate localizedStrings for them.
+    ///
     
-    if (!objectContainsUIString) {
-        
-        /// Special case: NSWindow titles
-        /// Explanation:
-        ///     NSWindow have both their `title` and their `subtitle` inside their `AXTitle` attribute. But the `title` and `subtitle` have separate
-        ///     localizedStrings. So we check the `title` and `subtitle` properties directly.
-        
-        if ([object isKindOfClass:[NSWindow class]]) {
-            BOOL uiStringIsTitle = [[((NSWindow *)object) title] isEqual:uiString];
-            BOOL uiStringIsSubtitle = [[((NSWindow *)object) subtitle] isEqual:uiString];
-            objectContainsUIString = uiStringIsTitle || uiStringIsSubtitle;
-        }
+    if ([object isKindOfClass:[NSMenu class]]) {
+        NSString *title = [((NSMenu *)object) title];
+        if (title.length > 0) [result addObject:title];
     }
     
-    if (!objectContainsUIString) {
-        
-        /// Special case: NSTabView
-        /// Explanation:
-        ///     We can't find any axElement that represents the tabViewItem's directly
-        ///         (Also see notes on that inside `getRepresentingAccessibilityElementForObject:`)
-        ///     That's why we pretend that the tabView holds the tabViewItem's strings, so that our validation code allows us to attach
-        ///     the annotations for the item directly to the tabView. Maybe we should use `forceValidation_` instead of this.
-        
-        if ([object isKindOfClass:[NSTabView class]]) {
-            NSTabView *tabView = (id)object;
-            for (NSTabViewItem *item in tabView.tabViewItems) {
-                BOOL uiStringIsLabel = [[item label] isEqual:uiString];
-                BOOL uiStringIsToolTip = [[item toolTip] isEqual:uiString];
-                objectContainsUIString = uiStringIsLabel || uiStringIsToolTip;
-                if (objectContainsUIString) break;
-            }
-        }
+    /// Special case: NSWindow titles
+    /// Explanation:
+    ///     NSWindow have both their `title` and their `subtitle` inside their `AXTitle` attribute. But the `title` and `subtitle` have separate
+    ///     localizedStrings. So we check the `title` and `subtitle` properties directly.
+    
+    if ([object isKindOfClass:[NSWindow class]]) {
+        NSString *title = [((NSWindow *)object) title];
+        NSString *subtitle = [((NSWindow *)object) subtitle];
+        if (title.length > 0) [result addObject:title];
+        if (subtitle.length > 0) [result addObject:subtitle];
     }
     
-    if (NO && !objectContainsUIString) {
-        
-        /// In this code we tried to check the `accessibilityTitleUIElement` property to find the uiString, but this doesn't seem to be necessary anymore with the other special-case-code we've implemented here and in geUIStringsFromAccessibilityElement
-        
-        NSObject<NSAccessibility>*titleUIElement = [(id)object accessibilityTitleUIElement];
-        if (titleUIElement != nil) {
-            if ([titleUIElement isKindOfClass:[NSAccessibilityProxy class]]) {
-                titleUIElement = [(NSAccessibilityProxy *)titleUIElement realElement];
-            }
-            objectContainsUIString = [self accessibilityElement:titleUIElement containsUIString:uiString];
+    /// Special case: NSTabView
+    /// Explanation:
+    ///     We can't find any axElement that represents the tabViewItem's directly
+    ///         (Also see notes on that inside `getRepresentingAccessibilityElementForObject:`)
+    ///     That's why we pretend that the tabView holds the tabViewItem's strings, so that our validation code allows us to attach
+    ///     the annotations for the item directly to the tabView. Maybe we should use `forceValidation_` instead of this.
+    
+    if ([object isKindOfClass:[NSTabView class]]) {
+        NSTabView *tabView = (id)object;
+        for (NSTabViewItem *item in tabView.tabViewItems) {
+            NSString *label = [item label];
+            NSString *toolTip = [item toolTip];
+            if (label.length > 0) [result addObject:label];
+            if (toolTip.length > 0) [result addObject:toolTip];
         }
     }
     
     /// Return
-    return objectContainsUIString;
+    return result;
 }
 
 + (BOOL)annotationElement:(NSAccessibilityElement *)element describesSomeUIStringOnAccessibilityElement:(NSObject <NSAccessibility>*)object additionalUIStringHolder:(NSObject *_Nullable)additionalUIStringHolder {
@@ -512,16 +676,10 @@ NSDictionary<NSString *, NSString *> *getUIStringsFromAXElement(NSObject<NSAcces
 }
 
 NSString *getUIStringFromAnnotation(NSAccessibilityElement *element) {
-    NSDictionary *elementData = [element accessibilityValue];
-    NSString *uiStringFromElement = elementData[@"mergedUIString"];
-    if (uiStringFromElement == nil || [uiStringFromElement isEqual:[NSNull null]] || uiStringFromElement.length == 0) {
-        uiStringFromElement = elementData[@"string"];
-    }
-    return uiStringFromElement;
+    return [getAnnotationRecord(element) uiString];
 }
 NSString *annotationDescription(NSAccessibilityElement *element) {
-    NSDictionary *elementData = [element accessibilityValue];
-    return [elementData description];
+    return [getAnnotationRecord(element) description];
 }
 
 #pragma mark - Utility
@@ -666,10 +824,36 @@ BOOL stringHasOnlyLocaleSharedContent(NSString *string) {
 }
 
 
+BOOL uiStringMightContainLocalizedString(NSString *uiString, NSString *localizedString) {
+    
+    /// Cheap prefilter for `uiStringByRemovingLocalizedString()`
+    ///     Returns NO if the `formatStringRecognizer(localizedString)` regex definitely won't match the uiString.
+    ///     The regex can only match if all the literal segments of the localizedString appear in the uiString in order. (The regex is case insensitive so we search case insensitively, too)
+    ///     Checking this is a few substring searches, which is much faster than running the regex. Most of the recorded strings we try to match against a uiString don't appear in it, so this lets us skip most of the regex evaluations.
+    
+    NSUInteger searchLocation = 0;
+    for (NSString *segment in formatStringLiteralSegments(localizedString)) {
+        if (segment.length == 0) continue;
+        NSRange searchRange = NSMakeRange(searchLocation, uiString.length - searchLocation);
+        NSRange segmentRange = [uiString rangeOfString:segment options:NSCaseInsensitiveSearch range:searchRange];
+        if (segmentRange.location == NSNotFound) {
+            return NO;
+        }
+        searchLocation = NSMaxRange(segmentRange);
+    }
+    
+    return YES;
+}
+
 NSString *uiStringByRemovingLocalizedString(NSString *uiString, NSString *localizedString) {
     
     /// TODO: Handle escaped percent (%%) int the localizedString
     
+    /// Prefilter
+    if (!uiStringMightContainLocalizedString(uiString, localizedString)) {
+        return uiString;
+    }
+    
     /// Get regex
     NSRegularExpression *localizedStringRegex = formatStringRecognizer(localizedString);
     
@@ -0,0 +1,84 @@
+//
+//  CaptureRecording.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+/// CaptureRecording
+///     Records the events that drive the code annotation, so that a capture session can be inspected and replayed without running the app's UI again.
+///
+///     Recorded events (in the order they happen):
+///     - Localized string retrievals (from the NSBundle swizzles in NSLocalizedStringRecord.m)
+///     - uiString setter calls (from `handleSetString:` in UIStringChangeDetector.m) - with class, selector, recursion depth and whether the caller is our executable
+///     - RunLoop ticks (the `kCFRunLoopBeforeTimers` cleanup in UIStringChangeDetector.m). Only recorded if something else was recorded since the last tick.
+///
+///     Enable recording by setting the `MFCaptureRecordingPath` user default (e.g. launch with `-MFCaptureRecordingPath /tmp/capture.mfcap`).
+///     When it's not set, the `MFCaptureRecord...()` functions return after checking a static flag.
+///
+/// File format:
+///     Little-endian binary. Starts with the 8-byte magic `MFCAP001`, followed by records:
+///     - uint8 type (`CaptureEventType`)
+///     - uint64 timestamp (nanoseconds since the recording started)
+///     - payload, depending on the type. Strings are a uint32 byte count followed by UTF-8 bytes. Integers are int64.
+///         - LocalizedStringRetrieval: table, key, value, result (strings), isSystemString (uint8)
+///         - UIStringSet:              objectClassName, selector, string (strings), recursionDepth (int64), flags (uint8, see `CaptureUIStringSetFlags`)
+///         - RunLoopTick:              (no payload)
+///     Use `+[CaptureEvent enumerateEventsInFile:usingBlock:]` to read a recording.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(uint8_t, CaptureEventType) {
+    CaptureEventTypeLocalizedStringRetrieval = 1,
+    CaptureEventTypeUIStringSet = 2,
+    CaptureEventTypeRunLoopTick = 3,
+};
+
+typedef NS_OPTIONS(uint8_t, CaptureUIStringSetFlags) {
+    CaptureUIStringSetFlagIsFromExecutable = 1 << 0,    /// The setter was called by code in our executable (instead of a system framework)
+    CaptureUIStringSetFlagIsLoadingNib = 1 << 1,
+    CaptureUIStringSetFlagSystemIsRenaming = 1 << 2,
+};
+
+///
+/// Recording
+///     Thread safe. (Localized strings are sometimes retrieved on background threads.)
+///
+
+BOOL MFCaptureRecordingIsEnabled(void);
+BOOL MFCaptureRecordingStart(NSString *path); /// Starts recording without the user default (used by the tests). Does nothing if we're already recording. Returns NO if the file couldn't be opened.
+void MFCaptureRecordLocalizedStringRetrieval(NSString *_Nullable table, NSString *_Nullable key, NSString *_Nullable value, NSString *_Nullable result, BOOL isSystemString);
+void MFCaptureRecordUIStringSet(Class cls, SEL selector, NSString *_Nullable string, NSInteger recursionDepth, CaptureUIStringSetFlags flags);
+void MFCaptureRecordRunLoopTick(void);
+void MFCaptureRecordingFlush(void);
+
+///
+/// Reading
+///
+
+@interface CaptureEvent : NSObject
+
+@property (nonatomic, readonly) CaptureEventType type;
+@property (nonatomic, readonly) uint64_t timestamp; /// Nanoseconds since the recording started
+
+/// LocalizedStringRetrieval
+@property (nonatomic, readonly, nullable) NSString *table;
+@property (nonatomic, readonly, nullable) NSString *key;
+@property (nonatomic, readonly, nullable) NSString *value;
+@property (nonatomic, readonly, nullable) NSString *result;
+@property (nonatomic, readonly) BOOL isSystemString;
+
+/// UIStringSet
+@property (nonatomic, readonly, nullable) NSString *objectClassName; /// Class of the object whose uiString was set
+@property (nonatomic, readonly, nullable) NSString *selector;
+@property (nonatomic, readonly, nullable) NSString *string;
+@property (nonatomic, readonly) NSInteger recursionDepth;
+@property (nonatomic, readonly) CaptureUIStringSetFlags flags;
+
++ (BOOL)enumerateEventsInFile:(NSString *)path usingBlock:(void (^)(CaptureEvent *event, BOOL *stop))block; /// Returns NO if the file couldn't be read or is malformed. A truncated last record (e.g. because the app crashed while recording) is skipped and doesn't count as malformed.
+
+@end
+
+NS_ASSUME_NONNULL_END
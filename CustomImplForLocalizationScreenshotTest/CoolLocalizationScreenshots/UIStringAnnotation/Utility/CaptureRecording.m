@@ -0,0 +1,305 @@
+//
+//  CaptureRecording.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 26.07.24.
+//
+
+///
+/// Implementation notes:
+///     Records are appended to a buffered `FILE *` under a lock. The buffer is flushed at the runLoop ticks and at exit, so a crash can lose at most the records of the current runLoop iteration.
+///     Almost all events come from the main thread, so the lock is practically never contended.
+///
+
+#import "CaptureRecording.h"
+#import <os/lock.h>
+#import <mach/mach_time.h>
+@import ObjectiveC.runtime;
+
+static const char kMagic[8] = {'M', 'F', 'C', 'A', 'P', '0', '0', '1'};
+
+static BOOL _isEnabled = NO;
+static FILE *_file = NULL;
+static os_unfair_lock _lock = OS_UNFAIR_LOCK_INIT;
+static uint64_t _startTime;
+static mach_timebase_info_data_t _timebase;
+static BOOL _hasRecordedSinceLastTick = NO;
+
+#pragma mark - Setup
+
+static void setUpRecording(void) {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *path = [NSUserDefaults.standardUserDefaults stringForKey:@"MFCaptureRecordingPath"];
+        if (path.length == 0) return;
+        MFCaptureRecordingStart(path);
+    });
+}
+
+BOOL MFCaptureRecordingStart(NSString *path) {
+    
+    os_unfair_lock_lock(&_lock);
+    
+    BOOL success = _isEnabled;
+    if (!_isEnabled) {
+        _file = fopen(path.stringByExpandingTildeInPath.fileSystemRepresentation, "wb");
+        if (_file == NULL) {
+            NSLog(@"CaptureRecording: Error: Couldn't open recording file at %@", path);
+        } else {
+            setvbuf(_file, NULL, _IOFBF, 64 * 1024);
+            fwrite(kMagic, sizeof(kMagic), 1, _file);
+            
+            _startTime = mach_absolute_time();
+            mach_timebase_info(&_timebase);
+            atexit(MFCaptureRecordingFlush);
+            
+            _isEnabled = YES;
+            success = YES;
+            NSLog(@"CaptureRecording: Recording capture events to %@", path);
+        }
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return success;
+}
+
+BOOL MFCaptureRecordingIsEnabled(void) {
+    setUpRecording();
+    return _isEnabled;
+}
+
+#pragma mark - Writing
+
+/// Note: The write functions expect `_lock` to be held
+
+static void writeUInt8(uint8_t value) {
+    fwrite(&value, sizeof(value), 1, _file);
+}
+static void writeUInt32(uint32_t value) {
+    value = OSSwapHostToLittleInt32(value);
+    fwrite(&value, sizeof(value), 1, _file);
+}
+static void writeUInt64(uint64_t value) {
+    value = OSSwapHostToLittleInt64(value);
+    fwrite(&value, sizeof(value), 1, _file);
+}
+static void writeString(NSString *string) {
+    
+    /// Notes:
+    /// - nil and empty strings are both written as length 0.
+    /// - We don't go through `UTF8String` + `strlen()`, since that would cut the string off at the first embedded NUL character.
+    
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    writeUInt32((uint32_t)length);
+    if (length == 0) return;
+    
+    char stackBuffer[256];
+    char *buffer = length <= sizeof(stackBuffer) ? stackBuffer : malloc(length);
+    NSUInteger usedLength = 0;
+    [string getBytes:buffer maxLength:length usedLength:&usedLength encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, string.length) remainingRange:NULL];
+    assert(usedLength == length);
+    fwrite(buffer, length, 1, _file);
+    if (buffer != stackBuffer) free(buffer);
+}
+static void writeRecordHeader(CaptureEventType type) {
+    uint64_t nanoseconds = (mach_absolute_time() - _startTime) * _timebase.numer / _timebase.denom;
+    writeUInt8(type);
+    writeUInt64(nanoseconds);
+}
+
+#pragma mark - Recording
+
+void MFCaptureRecordLocalizedStringRetrieval(NSString *table, NSString *key, NSString *value, NSString *result, BOOL isSystemString) {
+    
+    if (!MFCaptureRecordingIsEnabled()) return;
+    
+    os_unfair_lock_lock(&_lock);
+    writeRecordHeader(CaptureEventTypeLocalizedStringRetrieval);
+    writeString(table);
+    writeString(key);
+    writeString(value);
+    writeString(result);
+    writeUInt8(isSystemString ? 1 : 0);
+    _hasRecordedSinceLastTick = YES;
+    os_unfair_lock_unlock(&_lock);
+}
+
+void MFCaptureRecordUIStringSet(Class cls, SEL selector, NSString *string, NSInteger recursionDepth, CaptureUIStringSetFlags flags) {
+    
+    if (!MFCaptureRecordingIsEnabled()) return;
+    
+    os_unfair_lock_lock(&_lock);
+    writeRecordHeader(CaptureEventTypeUIStringSet);
+    writeString(@(class_getName(cls)));
+    writeString(@(sel_getName(selector)));
+    writeString(string);
+    writeUInt64((uint64_t)(int64_t)recursionDepth);
+    writeUInt8(flags);
+    _hasRecordedSinceLastTick = YES;
+    os_unfair_lock_unlock(&_lock);
+}
+
+void MFCaptureRecordRunLoopTick(void) {
+    
+    /// Notes:
+    /// - Most runLoop iterations don't retrieve or set any strings. Only recording ticks that follow other events keeps the recording small, while still preserving which events happened in the same runLoop iteration - which is what the UIStringChangeDetector cares about.
+    
+    if (!MFCaptureRecordingIsEnabled()) return;
+    
+    os_unfair_lock_lock(&_lock);
+    if (_hasRecordedSinceLastTick) {
+        writeRecordHeader(CaptureEventTypeRunLoopTick);
+        _hasRecordedSinceLastTick = NO;
+        fflush(_file);
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+void MFCaptureRecordingFlush(void) {
+    if (!_isEnabled) return;
+    os_unfair_lock_lock(&_lock);
+    fflush(_file);
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Reading
+
+@interface CaptureEvent ()
+
+@property (nonatomic, readwrite) CaptureEventType type;
+@property (nonatomic, readwrite) uint64_t timestamp;
+@property (nonatomic, readwrite, nullable) NSString *table;
+@property (nonatomic, readwrite, nullable) NSString *key;
+@property (nonatomic, readwrite, nullable) NSString *value;
+@property (nonatomic, readwrite, nullable) NSString *result;
+@property (nonatomic, readwrite) BOOL isSystemString;
+@property (nonatomic, readwrite, nullable) NSString *objectClassName;
+@property (nonatomic, readwrite, nullable) NSString *selector;
+@property (nonatomic, readwrite, nullable) NSString *string;
+@property (nonatomic, readwrite) NSInteger recursionDepth;
+@property (nonatomic, readwrite) CaptureUIStringSetFlags flags;
+
+@end
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+    BOOL failed;
+    BOOL reachedEnd; /// Failed because the data ended in the middle of a value
+} CaptureReader;
+
+static BOOL readBytes(CaptureReader *reader, void *out, size_t count) {
+    if (reader->failed) return NO;
+    if (reader->length - reader->offset < count) {
+        reader->failed = YES;
+        reader->reachedEnd = YES;
+        return NO;
+    }
+    memcpy(out, reader->bytes + reader->offset, count);
+    reader->offset += count;
+    return YES;
+}
+static uint8_t readUInt8(CaptureReader *reader) {
+    uint8_t value = 0;
+    readBytes(reader, &value, sizeof(value));
+    return value;
+}
+static uint32_t readUInt32(CaptureReader *reader) {
+    uint32_t value = 0;
+    readBytes(reader, &value, sizeof(value));
+    return OSSwapLittleToHostInt32(value);
+}
+static uint64_t readUInt64(CaptureReader *reader) {
+    uint64_t value = 0;
+    readBytes(reader, &value, sizeof(value));
+    return OSSwapLittleToHostInt64(value);
+}
+static NSString *readString(CaptureReader *reader) {
+    uint32_t length = readUInt32(reader);
+    if (reader->failed) return nil;
+    if (reader->length - reader->offset < length) {
+        reader->failed = YES;
+        reader->reachedEnd = YES;
+        return nil;
+    }
+    NSString *result = [[NSString alloc] initWithBytes:reader->bytes + reader->offset length:length encoding:NSUTF8StringEncoding];
+    reader->offset += length;
+    if (result == nil) reader->failed = YES; /// Invalid UTF-8
+    return result;
+}
+
+@implementation CaptureEvent
+
++ (BOOL)enumerateEventsInFile:(NSString *)path usingBlock:(void (^)(CaptureEvent * _Nonnull, BOOL * _Nonnull))block {
+    
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (data == nil) return NO;
+    
+    CaptureReader reader = { .bytes = data.bytes, .length = data.length, .offset = 0, .failed = NO, .reachedEnd = NO };
+    
+    /// Check magic
+    char magic[sizeof(kMagic)];
+    if (!readBytes(&reader, magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        return NO;
+    }
+    
+    /// Read records
+    while (reader.offset < reader.length) {
+        
+        CaptureEvent *event = [[CaptureEvent alloc] init];
+        event.type = readUInt8(&reader);
+        event.timestamp = readUInt64(&reader);
+        
+        switch (event.type) {
+            case CaptureEventTypeLocalizedStringRetrieval:
+                event.table = readString(&reader);
+                event.key = readString(&reader);
+                event.value = readString(&reader);
+                event.result = readString(&reader);
+                event.isSystemString = readUInt8(&reader) != 0;
+                break;
+            case CaptureEventTypeUIStringSet:
+                event.objectClassName = readString(&reader);
+                event.selector = readString(&reader);
+                event.string = readString(&reader);
+                event.recursionDepth = (NSInteger)(int64_t)readUInt64(&reader);
+                event.flags = readUInt8(&reader);
+                break;
+            case CaptureEventTypeRunLoopTick:
+                break;
+            default:
+                return NO; /// Unknown type - we can't know how long the record is.
+        }
+        
+        /// Handle errors
+        ///     A truncated last record is expected if the app crashed while recording. We just stop there, since all the records before it were fine.
+        if (reader.failed) {
+            if (reader.reachedEnd) break;
+            return NO;
+        }
+        
+        BOOL stop = NO;
+        block(event, &stop);
+        if (stop) break;
+    }
+    
+    return YES;
+}
+
+- (NSString *)description {
+    double milliseconds = (double)_timestamp / NSEC_PER_MSEC;
+    switch (_type) {
+        case CaptureEventTypeLocalizedStringRetrieval:
+            return [NSString stringWithFormat:@"[%10.3f ms] Retrieval: %@ : %@ -> \"%@\"%@", milliseconds, _table, _key, _result, _isSystemString ? @" (system)" : @""];
+        case CaptureEventTypeUIStringSet:
+            return [NSString stringWithFormat:@"[%10.3f ms] Set: [%@ %@\"%@\"] (recursionDepth %ld) (flags %d)", milliseconds, _objectClassName, _selector, _string, (long)_recursionDepth, _flags];
+        case CaptureEventTypeRunLoopTick:
+            return [NSString stringWithFormat:@"[%10.3f ms] RunLoop tick", milliseconds];
+    }
+    return [NSString stringWithFormat:@"[%10.3f ms] Unknown event type %d", milliseconds, _type];
+}
+
+@end
@@ -0,0 +1,81 @@
+//
+//  ArenaTree.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 25.07.24.
+//
+
+/// Explanation:
+/// Flat, immutable tree. All the nodes live in a few arrays and are referred to by their index. `ArenaTreeNoNode` (-1) means 'no node' (e.g. the parent of the root).
+/// We use this instead of `TreeNode` for the nib decoder record, since TreeNode allocates an object per node and goes through `indexPath` to find siblings, which was slow for big nib files.
+
+#import <Foundation/Foundation.h>
+#import "TreeNode.h" /// For MFTreeTraversal
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NSInteger ArenaTreeIndex;
+#define ArenaTreeNoNode ((ArenaTreeIndex)-1)
+
+@interface ArenaTree<T> : NSObject
+
+/// Create tree
+///     From a list of objects in post-order (children before their parents, siblings in order) along with the depth of each object. The object at depth 0 is the root.
+///     This is the format of the nib decoder record, which records each object after all its children have been decoded.
+///     The index of each node in the tree is the same as the index of its object in `objects`. That also means that iterating the indexes from 0 to `count`-1 visits the nodes depth-first (post-order).
++ (ArenaTree<T> *_Nullable)treeWithPostOrderObjects:(NSArray<T> *)objects depths:(const NSInteger *)depths; /// Returns nil if the depths don't describe a single tree
+
+/// Size
+- (NSInteger)count;
+
+/// Content
+- (T)objectAtIndex:(ArenaTreeIndex)node;
+- (NSInteger)depthOfNode:(ArenaTreeIndex)node;
+
+/// Navigation
+- (ArenaTreeIndex)root;
+- (ArenaTreeIndex)parentOfNode:(ArenaTreeIndex)node;
+- (ArenaTreeIndex)firstChildOfNode:(ArenaTreeIndex)node;
+- (ArenaTreeIndex)lastChildOfNode:(ArenaTreeIndex)node;
+- (ArenaTreeIndex)nextSiblingOfNode:(ArenaTreeIndex)node;
+- (ArenaTreeIndex)previousSiblingOfNode:(ArenaTreeIndex)node;
+- (ArenaTreeIndex)childAtIndex:(NSInteger)childIndex ofNode:(ArenaTreeIndex)node; /// O(childIndex)
+
+/// Other
+- (NSString *)descriptionOfNode:(ArenaTreeIndex)node; /// Same format as `-[TreeNode description]`
+- (NSString *)description;
+
+/// Streaming description
+///     Writes the same output as `-descriptionOfNode:` straight to a file descriptor (e.g. STDOUT_FILENO) through a small fixed-size buffer, instead of building one giant string first.
+///     `maxDepth` and `maxNodeCount` limit how much of the tree is written, relative to `node`. Pass NSIntegerMax for no limit. Omitted nodes are summarized in a `...` line.
+- (void)writeDescriptionOfNode:(ArenaTreeIndex)node toFileDescriptor:(int)fd maxDepth:(NSInteger)maxDepth maxNodeCount:(NSInteger)maxNodeCount;
+
+@end
+
+///
+/// Cursor
+///     Replacement for `TreeEnumerator` over an ArenaTree. It's a plain struct that lives on the stack, and stepping it doesn't allocate or send any messages.
+///     Ordering is the same as for `TreeEnumerator` with the same `MFTreeTraversal`:
+///     - MFTreeTraversalDepthFirst:        Post-order over the subtree of the start node. Children are visited in order, and before their parent. The start node is visited last - even if it has no children. (`TreeEnumerator` skips a childless start node.)
+///     - MFTreeTraversalParents:           The parent, grandparent, ... up to the root of the tree. Doesn't include the start node.
+///     - MFTreeTraversalSiblingsForward:   The siblings after the start node, in order. Doesn't include the start node.
+///     - MFTreeTraversalSiblingsBackward:  The siblings before the start node, in reverse order. Doesn't include the start node.
+///     The cursor doesn't retain the tree, so you need to keep the tree alive while using it.
+///
+/// Example:
+///     ```
+///     ArenaTreeCursor cursor = ArenaTreeCursorMake(tree, tree.root, MFTreeTraversalDepthFirst);
+///     for (ArenaTreeIndex node = ArenaTreeCursorNext(&cursor); node != ArenaTreeNoNode; node = ArenaTreeCursorNext(&cursor)) { ... }
+///     ```
+
+typedef struct {
+    __unsafe_unretained ArenaTree *tree;
+    MFTreeTraversal traversal;
+    ArenaTreeIndex next; /// The node that the next call to `ArenaTreeCursorNext()` returns
+    ArenaTreeIndex last; /// Depth first only: The start node, which is the last node of the traversal.
+} ArenaTreeCursor;
+
+ArenaTreeCursor ArenaTreeCursorMake(ArenaTree *tree, ArenaTreeIndex startNode, MFTreeTraversal traversal);
+ArenaTreeIndex ArenaTreeCursorNext(ArenaTreeCursor *cursor); /// Returns ArenaTreeNoNode once the traversal is done
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,407 @@
+//
+//  ArenaTree.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 25.07.24.
+//
+
+#import "ArenaTree.h"
+#import <unistd.h>
+
+@implementation ArenaTree {
+    NSArray *_objects;
+    NSInteger _count;
+    ArenaTreeIndex _root;
+    ArenaTreeIndex *_parent;
+    ArenaTreeIndex *_firstChild;
+    ArenaTreeIndex *_lastChild;
+    ArenaTreeIndex *_nextSibling;
+    ArenaTreeIndex *_previousSibling;
+    NSInteger *_depth;
+}
+
++ (ArenaTree *_Nullable)treeWithPostOrderObjects:(NSArray *)objects depths:(const NSInteger *)depths {
+    
+    ///
+    /// Explanation:
+    ///     We go through the objects in reverse. Reversed post-order is a pre-order where the children of each node are visited from last to first.
+    ///     In a pre-order, the parent of a node at depth `d` is always the node at depth `d-1` that we've seen most recently. So we just need to remember the most recently seen node for each depth (`lastNodeAtDepth`).
+    ///     Since we see the children from last to first, we prepend each child to its parent's list of children, so they end up in the original order.
+    ///     This is O(n) - (The old `TreeNode`-based implementation walked up the parents for each node and validated with `indexPath`, which is O(depth) per node.)
+    ///
+    
+    /// Init
+    ArenaTree *tree = [[ArenaTree alloc] init];
+    NSInteger n = objects.count;
+    tree->_objects = [objects copy];
+    tree->_count = n;
+    tree->_root = ArenaTreeNoNode;
+    tree->_parent           = malloc(MAX(n, 1) * sizeof(ArenaTreeIndex));
+    tree->_firstChild       = malloc(MAX(n, 1) * sizeof(ArenaTreeIndex));
+    tree->_lastChild        = malloc(MAX(n, 1) * sizeof(ArenaTreeIndex));
+    tree->_nextSibling      = malloc(MAX(n, 1) * sizeof(ArenaTreeIndex));
+    tree->_previousSibling  = malloc(MAX(n, 1) * sizeof(ArenaTreeIndex));
+    tree->_depth            = malloc(MAX(n, 1) * sizeof(NSInteger));
+    
+    /// Declare state
+    NSInteger maxDepth = 0;
+    for (NSInteger i = 0; i < n; i++) maxDepth = MAX(maxDepth, depths[i]);
+    ArenaTreeIndex *lastNodeAtDepth = malloc((maxDepth + 1) * sizeof(ArenaTreeIndex));
+    for (NSInteger d = 0; d <= maxDepth; d++) lastNodeAtDepth[d] = ArenaTreeNoNode;
+    
+    /// Build tree
+    NSInteger previousDepth = -1;
+    for (NSInteger i = n - 1; i >= 0; i--) {
+        
+        NSInteger depth = depths[i];
+        
+        /// Validate depth
+        ///     In the pre-order, each node can be at most one level deeper than the node before it. (The first node is the root at depth 0.)
+        ///     If it's deeper, `lastNodeAtDepth[depth - 1]` would be a stale node from an earlier subtree, and we'd silently attach the node to the wrong parent.
+        if (depth < 0 || depth > previousDepth + 1 || (depth == 0 && tree->_root != ArenaTreeNoNode)) {
+            NSLog(@"ArenaTree: Error: Malformed depths at index %ld (depth %ld after depth %ld)", (long)i, (long)depth, (long)previousDepth);
+            assert(false);
+            free(lastNodeAtDepth);
+            return nil;
+        }
+        previousDepth = depth;
+        
+        /// Init node
+        tree->_depth[i] = depth;
+        tree->_firstChild[i] = ArenaTreeNoNode;
+        tree->_lastChild[i] = ArenaTreeNoNode;
+        tree->_previousSibling[i] = ArenaTreeNoNode;
+        tree->_nextSibling[i] = ArenaTreeNoNode;
+        
+        /// Root
+        if (depth == 0) {
+            tree->_root = i;
+            tree->_parent[i] = ArenaTreeNoNode;
+            lastNodeAtDepth[0] = i;
+            continue;
+        }
+        
+        /// Find parent
+        ArenaTreeIndex parent = lastNodeAtDepth[depth - 1];
+        
+        assert(parent != ArenaTreeNoNode);
+        
+        /// Prepend to parent's children
+        ArenaTreeIndex oldFirstChild = tree->_firstChild[parent];
+        tree->_parent[i] = parent;
+        tree->_nextSibling[i] = oldFirstChild;
+        if (oldFirstChild != ArenaTreeNoNode) {
+            tree->_previousSibling[oldFirstChild] = i;
+        } else {
+            tree->_lastChild[parent] = i;
+        }
+        tree->_firstChild[parent] = i;
+        
+        /// Update state
+        lastNodeAtDepth[depth] = i;
+    }
+    
+    free(lastNodeAtDepth);
+    
+    /// Return
+    return tree;
+}
+
+- (void)dealloc {
+    free(_parent);
+    free(_firstChild);
+    free(_lastChild);
+    free(_nextSibling);
+    free(_previousSibling);
+    free(_depth);
+}
+
+///
+/// Interface
+///
+
+- (NSInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(ArenaTreeIndex)node {
+    assert(0 <= node && node < _count);
+    return _objects[node];
+}
+- (NSInteger)depthOfNode:(ArenaTreeIndex)node {
+    assert(0 <= node && node < _count);
+    return _depth[node];
+}
+
+- (ArenaTreeIndex)root {
+    return _root;
+}
+- (ArenaTreeIndex)parentOfNode:(ArenaTreeIndex)node {
+    if (node == ArenaTreeNoNode) return ArenaTreeNoNode;
+    return _parent[node];
+}
+- (ArenaTreeIndex)firstChildOfNode:(ArenaTreeIndex)node {
+    if (node == ArenaTreeNoNode) return ArenaTreeNoNode;
+    return _firstChild[node];
+}
+- (ArenaTreeIndex)lastChildOfNode:(ArenaTreeIndex)node {
+    if (node == ArenaTreeNoNode) return ArenaTreeNoNode;
+    return _lastChild[node];
+}
+- (ArenaTreeIndex)nextSiblingOfNode:(ArenaTreeIndex)node {
+    if (node == ArenaTreeNoNode) return ArenaTreeNoNode;
+    return _nextSibling[node];
+}
+- (ArenaTreeIndex)previousSiblingOfNode:(ArenaTreeIndex)node {
+    if (node == ArenaTreeNoNode) return ArenaTreeNoNode;
+    return _previousSibling[node];
+}
+- (ArenaTreeIndex)childAtIndex:(NSInteger)childIndex ofNode:(ArenaTreeIndex)node {
+    ArenaTreeIndex child = [self firstChildOfNode:node];
+    for (NSInteger i = 0; i < childIndex && child != ArenaTreeNoNode; i++) {
+        child = _nextSibling[child];
+    }
+    return child;
+}
+
+///
+/// Description
+///
+
+- (NSString *)descriptionOfNode:(ArenaTreeIndex)node {
+    
+    /// Produces the same output as `-[TreeNode description]`: Each child is indented by 4 more spaces than its parent and starts with a `- ` bullet.
+    ///     But instead of building the description of each subtree and then re-indenting it at every level, we walk the subtree once and append each line with its final indentation.
+    
+    NSMutableString *result = [NSMutableString string];
+    if (node == ArenaTreeNoNode) return result;
+    
+    NSInteger baseDepth = _depth[node];
+    ArenaTreeIndex current = node;
+    
+    while (current != ArenaTreeNoNode) {
+        
+        /// Append current node
+        NSInteger relativeDepth = _depth[current] - baseDepth;
+        NSString *nodeDescription = [_objects[current] description];
+        NSInteger indent = relativeDepth * 4;
+        
+        if (current != node) {
+            [result appendString:@"\n"];
+        }
+        NSArray<NSString *> *lines = [nodeDescription componentsSeparatedByString:@"\n"];
+        for (NSUInteger l = 0; l < lines.count; l++) {
+            if (l > 0) [result appendString:@"\n"];
+            if (l == 0 && relativeDepth > 0) {
+                [result appendFormat:@"%*s- ", (int)(indent - 2), ""]; /// Bullet
+            } else {
+                [result appendFormat:@"%*s", (int)indent, ""];
+            }
+            [result appendString:lines[l]];
+        }
+        
+        /// Go to next node in pre-order
+        if (_firstChild[current] != ArenaTreeNoNode) {
+            current = _firstChild[current];
+        } else {
+            while (current != node && _nextSibling[current] == ArenaTreeNoNode) {
+                current = _parent[current];
+            }
+            current = (current == node) ? ArenaTreeNoNode : _nextSibling[current];
+        }
+    }
+    
+    return result;
+}
+
+- (NSString *)description {
+    return [self descriptionOfNode:_root];
+}
+
+///
+/// Streaming description
+///
+
+typedef struct {
+    int fd;
+    char bytes[4096];
+    size_t length;
+} DumpBuffer;
+
+static void dumpBufferFlush(DumpBuffer *buffer) {
+    size_t written = 0;
+    while (written < buffer->length) {
+        ssize_t result = write(buffer->fd, buffer->bytes + written, buffer->length - written);
+        if (result <= 0) break; /// Just drop the output on error - this is only for debugging
+        written += result;
+    }
+    buffer->length = 0;
+}
+
+static void dumpBufferAppend(DumpBuffer *buffer, const char *bytes, size_t length) {
+    while (length > 0) {
+        if (buffer->length == sizeof(buffer->bytes)) {
+            dumpBufferFlush(buffer);
+        }
+        size_t chunk = MIN(length, sizeof(buffer->bytes) - buffer->length);
+        memcpy(buffer->bytes + buffer->length, bytes, chunk);
+        buffer->length += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+}
+
+static void dumpBufferAppendSpaces(DumpBuffer *buffer, NSInteger count) {
+    static const char spaces[] = "                                ";
+    while (count > 0) {
+        NSInteger chunk = MIN(count, (NSInteger)(sizeof(spaces) - 1));
+        dumpBufferAppend(buffer, spaces, chunk);
+        count -= chunk;
+    }
+}
+
+- (void)writeDescriptionOfNode:(ArenaTreeIndex)node toFileDescriptor:(int)fd maxDepth:(NSInteger)maxDepth maxNodeCount:(NSInteger)maxNodeCount {
+    
+    /// Walks the subtree in pre-order, exactly like `-descriptionOfNode:`. But each line goes straight into `buffer`, which is flushed to `fd` whenever it's full.
+    ///     So the memory use doesn't depend on the size of the tree, and when we hit the limits we stop without having built the rest of the description.
+    
+    if (node == ArenaTreeNoNode) return;
+    
+    DumpBuffer buffer = { .fd = fd, .length = 0 };
+    
+    NSInteger baseDepth = _depth[node];
+    NSInteger writtenNodeCount = 0;
+    ArenaTreeIndex current = node;
+    
+    while (current != ArenaTreeNoNode) {
+        
+        NSInteger relativeDepth = _depth[current] - baseDepth;
+        NSInteger indent = relativeDepth * 4;
+        
+        /// Stop at node limit
+        if (writtenNodeCount >= maxNodeCount) {
+            dumpBufferAppend(&buffer, "\n... (stopped after ", strlen("\n... (stopped after "));
+            char countString[32];
+            int countLength = snprintf(countString, sizeof(countString), "%ld", (long)writtenNodeCount);
+            dumpBufferAppend(&buffer, countString, countLength);
+            dumpBufferAppend(&buffer, " nodes)", strlen(" nodes)"));
+            break;
+        }
+        
+        /// Append current node
+        ///     Indent all lines of a multi-line description, and put a bullet before the first line.
+        if (current != node) {
+            dumpBufferAppend(&buffer, "\n", 1);
+        }
+        if (relativeDepth > 0) {
+            dumpBufferAppendSpaces(&buffer, indent - 2);
+            dumpBufferAppend(&buffer, "- ", 2);
+        }
+        @autoreleasepool {
+            const char *description = [[_objects[current] description] UTF8String] ?: "(null)";
+            const char *lineStart = description;
+            for (const char *c = description; ; c++) {
+                if (*c == '\n' || *c == '\0') {
+                    dumpBufferAppend(&buffer, lineStart, c - lineStart);
+                    if (*c == '\0') break;
+                    dumpBufferAppend(&buffer, "\n", 1);
+                    dumpBufferAppendSpaces(&buffer, indent);
+                    lineStart = c + 1;
+                }
+            }
+        }
+        writtenNodeCount += 1;
+        
+        /// Skip children below the depth limit
+        BOOL descend = _firstChild[current] != ArenaTreeNoNode;
+        if (descend && relativeDepth >= maxDepth) {
+            descend = NO;
+            dumpBufferAppend(&buffer, "\n", 1);
+            dumpBufferAppendSpaces(&buffer, indent + 2);
+            dumpBufferAppend(&buffer, "- ...", strlen("- ..."));
+        }
+        
+        /// Go to next node in pre-order
+        if (descend) {
+            current = _firstChild[current];
+        } else {
+            while (current != node && _nextSibling[current] == ArenaTreeNoNode) {
+                current = _parent[current];
+            }
+            current = (current == node) ? ArenaTreeNoNode : _nextSibling[current];
+        }
+    }
+    
+    dumpBufferAppend(&buffer, "\n", 1);
+    dumpBufferFlush(&buffer);
+}
+
+///
+/// Cursor
+///
+///     Notes:
+///     - These are defined inside the @implementation so they can read the node arrays directly.
+///     - The depth first cursor doesn't need a stack: The nodes are stored in post-order, so the subtree of a node is the contiguous range of indexes that ends at the node itself and starts at its first leaf (the node we reach by following first children).
+///
+
+ArenaTreeCursor ArenaTreeCursorMake(ArenaTree *tree, ArenaTreeIndex startNode, MFTreeTraversal traversal) {
+    
+    ArenaTreeCursor cursor = {
+        .tree = tree,
+        .traversal = traversal,
+        .next = ArenaTreeNoNode,
+        .last = ArenaTreeNoNode,
+    };
+    
+    if (tree == nil || startNode == ArenaTreeNoNode) {
+        return cursor;
+    }
+    assert(0 <= startNode && startNode < tree->_count);
+    
+    if (traversal == MFTreeTraversalDepthFirst) {
+        ArenaTreeIndex firstLeaf = startNode;
+        while (tree->_firstChild[firstLeaf] != ArenaTreeNoNode) {
+            firstLeaf = tree->_firstChild[firstLeaf];
+        }
+        cursor.next = firstLeaf;
+        cursor.last = startNode;
+    } else if (traversal == MFTreeTraversalParents) {
+        cursor.next = tree->_parent[startNode];
+    } else if (traversal == MFTreeTraversalSiblingsForward) {
+        cursor.next = tree->_nextSibling[startNode];
+    } else if (traversal == MFTreeTraversalSiblingsBackward) {
+        cursor.next = tree->_previousSibling[startNode];
+    } else {
+        NSLog(@"Error: Unknown tree traversal type.");
+        assert(false);
+    }
+    
+    return cursor;
+}
+
+ArenaTreeIndex ArenaTreeCursorNext(ArenaTreeCursor *cursor) {
+    
+    ArenaTreeIndex node = cursor->next;
+    if (node == ArenaTreeNoNode) {
+        return ArenaTreeNoNode;
+    }
+    
+    ArenaTree *tree = cursor->tree;
+    
+    if (cursor->traversal == MFTreeTraversalDepthFirst) {
+        cursor->next = (node == cursor->last) ? ArenaTreeNoNode : node + 1;
+    } else if (cursor->traversal == MFTreeTraversalParents) {
+        cursor->next = tree->_parent[node];
+    } else if (cursor->traversal == MFTreeTraversalSiblingsForward) {
+        cursor->next = tree->_nextSibling[node];
+    } else if (cursor->traversal == MFTreeTraversalSiblingsBackward) {
+        cursor->next = tree->_previousSibling[node];
+    } else {
+        assert(false);
+        cursor->next = ArenaTreeNoNode;
+    }
+    
+    return node;
+}
+
+@end
@@ -0,0 +1,39 @@
+//
+//  LRUCache.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 24.07.24.
+//
+
+/// Simple key-value cache with a fixed maximum number of entries.
+///     When the cache is full, the least recently used entry is evicted.
+///     We made this instead of using NSCache, since NSCache doesn't document which entries it evicts, and it also evicts stuff on memory pressure at random times, which makes performance unpredictable.
+///
+/// Not thread safe.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface LRUCache<KeyType, ObjectType> : NSObject
+
++ (LRUCache<KeyType, ObjectType> *)cacheWithCountLimit:(NSUInteger)countLimit;
+- (instancetype)initWithCountLimit:(NSUInteger)countLimit;
+
+- (ObjectType _Nullable)objectForKey:(KeyType<NSCopying>)key; /// Marks the entry as most recently used
+- (void)setObject:(ObjectType)object forKey:(KeyType<NSCopying>)key;
+- (void)removeObjectForKey:(KeyType<NSCopying>)key;
+- (void)removeAllObjects;
+
+- (NSUInteger)count;
+- (NSUInteger)countLimit;
+
+/// Stats
+///     For debugging. These are never reset, except by `removeAllObjects`.
+- (NSUInteger)hitCount;
+- (NSUInteger)missCount;
+- (NSUInteger)evictionCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,196 @@
+//
+//  LRUCache.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 24.07.24.
+//
+
+#import "LRUCache.h"
+
+///
+/// Implementation notes:
+///     The entries are stored in a dictionary for O(1) lookup, and they are additionally chained into a doubly linked list which is ordered by recency of use.
+///     The head of the list is the most recently used entry, the tail is the least recently used entry - which is what we evict when the cache is full.
+///     The `next` pointers are strong and the `prev` pointers are unretained. The dictionary also retains all the nodes, so none of the nodes will be freed while they're still in the list.
+///
+
+@interface LRUCacheNode : NSObject {
+    @public
+    id _key;
+    id _object;
+    LRUCacheNode *_next;
+    __unsafe_unretained LRUCacheNode *_prev;
+}
+@end
+@implementation LRUCacheNode
+@end
+
+@implementation LRUCache {
+    NSMutableDictionary<id, LRUCacheNode *> *_nodes;
+    LRUCacheNode *_head;
+    __unsafe_unretained LRUCacheNode *_tail;
+    NSUInteger _countLimit;
+    NSUInteger _hitCount;
+    NSUInteger _missCount;
+    NSUInteger _evictionCount;
+}
+
++ (LRUCache *)cacheWithCountLimit:(NSUInteger)countLimit {
+    return [[LRUCache alloc] initWithCountLimit:countLimit];
+}
+
+- (instancetype)initWithCountLimit:(NSUInteger)countLimit {
+
+    assert(countLimit > 0);
+
+    self = [super init];
+    if (self) {
+        _nodes = [NSMutableDictionary dictionaryWithCapacity:countLimit];
+        _countLimit = countLimit;
+    }
+    return self;
+}
+
+///
+/// Main interface
+///
+
+- (id)objectForKey:(id)key {
+
+    LRUCacheNode *node = _nodes[key];
+
+    if (node == nil) {
+        _missCount += 1;
+        return nil;
+    }
+
+    _hitCount += 1;
+    [self moveNodeToHead:node];
+    return node->_object;
+}
+
+- (void)setObject:(id)object forKey:(id)key {
+
+    assert(object != nil);
+
+    /// Update existing entry
+    LRUCacheNode *node = _nodes[key];
+    if (node != nil) {
+        node->_object = object;
+        [self moveNodeToHead:node];
+        return;
+    }
+
+    /// Make room
+    if (_nodes.count >= _countLimit) {
+        [self evictTail];
+    }
+
+    /// Insert new entry
+    node = [[LRUCacheNode alloc] init];
+    node->_key = [key copy]; /// Copy just like NSDictionary does
+    node->_object = object;
+    _nodes[node->_key] = node;
+    [self insertNodeAtHead:node];
+}
+
+- (void)removeObjectForKey:(id)key {
+    LRUCacheNode *node = _nodes[key];
+    if (node == nil) return;
+    [self unlinkNode:node];
+    [_nodes removeObjectForKey:key];
+}
+
+- (void)removeAllObjects {
+
+    /// Break the chain iteratively
+    ///     Otherwise, releasing `_head` would release the entire chain recursively, which might overflow the stack for large caches.
+    LRUCacheNode *node = _head;
+    while (node != nil) {
+        LRUCacheNode *next = node->_next;
+        node->_next = nil;
+        node = next;
+    }
+
+    [_nodes removeAllObjects];
+    _head = nil;
+    _tail = nil;
+    _hitCount = 0;
+    _missCount = 0;
+    _evictionCount = 0;
+}
+
+- (void)dealloc {
+    [self removeAllObjects];
+}
+
+- (NSUInteger)count {
+    return _nodes.count;
+}
+- (NSUInteger)countLimit {
+    return _countLimit;
+}
+- (NSUInteger)hitCount {
+    return _hitCount;
+}
+- (NSUInteger)missCount {
+    return _missCount;
+}
+- (NSUInteger)evictionCount {
+    return _evictionCount;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> count: %lu/%lu, hits: %lu, misses: %lu, evictions: %lu", [self class], self, _nodes.count, _countLimit, _hitCount, _missCount, _evictionCount];
+}
+
+///
+/// Linked list helpers
+///
+
+- (void)insertNodeAtHead:(LRUCacheNode *)node {
+    node->_prev = nil;
+    node->_next = _head;
+    if (_head != nil) {
+        _head->_prev = node;
+    }
+    _head = node;
+    if (_tail == nil) {
+        _tail = node;
+    }
+}
+
+- (void)unlinkNode:(LRUCacheNode *)node {
+
+    /// Retain the node while we're unlinking it, since `_head` or `_prev->_next` might be the last strong ref (aside from the dict)
+    LRUCacheNode *retainedNode = node;
+
+    if (retainedNode->_prev != nil) {
+        retainedNode->_prev->_next = retainedNode->_next;
+    } else {
+        _head = retainedNode->_next;
+    }
+    if (retainedNode->_next != nil) {
+        retainedNode->_next->_prev = retainedNode->_prev;
+    } else {
+        _tail = retainedNode->_prev;
+    }
+    retainedNode->_next = nil;
+    retainedNode->_prev = nil;
+}
+
+- (void)moveNodeToHead:(LRUCacheNode *)node {
+    if (node == _head) return;
+    [self unlinkNode:node];
+    [self insertNodeAtHead:node];
+}
+
+- (void)evictTail {
+    LRUCacheNode *tail = _tail;
+    if (tail == nil) return;
+    [self unlinkNode:tail];
+    [_nodes removeObjectForKey:tail->_key];
+    _evictionCount += 1;
+}
+
+@end
@@ -10,20 +10,33 @@
 /// We copied and adapted this fom MMF
 /// -> Should probably copy this back into MMF
 
+/// Notes:
+/// - This is a ring buffer. Enqueuing and dequeuing are O(1) (amortized). Looking up or removing an object via its handle is O(log n).
+/// - `enqueue:` returns a handle, which stays valid until the object is dequeued or removed. You can use it to remove the object from the middle of the queue without searching for it.
+///     Handles are never reused, so using the handle of an object that has already been removed is safe and simply does nothing.
+/// - `peekAll` and `dequeueAll` return the objects in the order they were enqueued (first object is the one that `dequeue` would return next)
+/// - Use `enumerateObjectsUsingBlock:` to look at the objects without copying them. Don't mutate the queue inside the block.
+
 #import <Foundation/Foundation.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
+typedef uint64_t QueueHandle;
+
 @interface Queue<T> : NSObject
 + (Queue<T> *)queue;
-- (void)enqueue:(T)obj;
-- (T)dequeue;
+- (QueueHandle)enqueue:(T)obj;
+- (T _Nullable)dequeue;
 - (NSArray <T>*)dequeueAll;
 - (NSArray <T>*)peekAll;
-- (T)peek;
+- (T _Nullable)peek;
 - (BOOL)isEmpty;
 - (int64_t)count;
-- (NSMutableArray <T>*)_rawStorage;
+
+- (T _Nullable)objectForHandle:(QueueHandle)handle;
+- (void)removeObjectWithHandle:(QueueHandle)handle;
+- (void)removeAllObjects;
+- (void)enumerateObjectsUsingBlock:(void (^)(T obj, QueueHandle handle, BOOL *stop))block;
 @end
 
 NS_ASSUME_NONNULL_END
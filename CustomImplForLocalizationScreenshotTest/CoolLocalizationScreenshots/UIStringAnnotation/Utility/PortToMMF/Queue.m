@@ -7,10 +7,29 @@
 // --------------------------------------------------------------------------
 //
 
+///
+/// Implementation notes:
+///     The objects are stored in a ring buffer of `_capacity` slots, in the order they were enqueued. `_capacity` is always a power of 2.
+///     The ring holds `_size` slots starting at the physical index `_head`. Each slot stores its object along with its sequence number, which is also the object's handle.
+///     Since the slots are in enqueue order, their sequence numbers are strictly increasing, so we can find the slot for a handle with a binary search.
+///     Removing an object via its handle just sets its slot to nil (leaving a 'hole'). The holes are skipped when dequeuing / enumerating, and the ones at the head are dropped right away.
+///     When the ring is full, we compact it (drop all the holes) - and only grow it if it's still more than half full afterwards. That way, the memory use and the cost of enumerating
+///     are proportional to the number of objects in the queue - even if an old object stays in the queue while lots of others are enqueued and removed after it.
+///     Since the sequence numbers only ever go up, handles are never reused.
+///
+///     Previously, this was backed by an NSMutableArray where `enqueue:` inserted at index 0, which made enqueuing O(n).
+///
+
 #import "Queue.h"
 
 @implementation Queue {
-    NSMutableArray *_storage;
+    __strong id *_slots;
+    QueueHandle *_seqs;
+    uint64_t _capacity;
+    uint64_t _head;     /// Physical index of the first slot
+    uint64_t _size;     /// Number of slots in use, including holes
+    int64_t _count;     /// Number of objects
+    QueueHandle _nextSeq;
 }
 
 + (id)queue {
@@ -21,42 +40,203 @@
 {
     self = [super init];
     if (self) {
-        _storage = [NSMutableArray array];
+        _capacity = 16;
+        _slots = (__strong id *)calloc(_capacity, sizeof(id)); /// Zeroed memory is required for ARC to treat the slots as nil
+        _seqs = calloc(_capacity, sizeof(QueueHandle));
+        _head = 0;
+        _size = 0;
+        _count = 0;
+        _nextSeq = 0;
     }
     return self;
 }
 
-- (void)enqueue:(id)obj {
-    [_storage insertObject:obj atIndex:0];
+- (void)dealloc {
+    [self removeAllObjects];
+    free(_slots);
+    free(_seqs);
+}
+
+///
+/// Helpers
+///
+
+#define physicalIndex(__i) ((_head + (__i)) & (_capacity - 1))  /// `__i` is the index of the slot counted from the head
+#define slotAt(__i) _slots[physicalIndex(__i)]
+#define seqAt(__i) _seqs[physicalIndex(__i)]
+
+- (void)dropHolesAtHead {
+    while (_size > 0 && slotAt(0) == nil) {
+        _head = (_head + 1) & (_capacity - 1);
+        _size -= 1;
+    }
+}
+
+- (uint64_t)indexForHandle:(QueueHandle)handle {
+    
+    /// Binary search. Returns `_size` if there's no slot for the handle.
+    
+    uint64_t low = 0;
+    uint64_t high = _size;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        QueueHandle seq = seqAt(mid);
+        if (seq == handle) return mid;
+        if (seq < handle) low = mid + 1;
+        else high = mid;
+    }
+    return _size;
+}
+
+- (void)compactIntoCapacity:(uint64_t)newCapacity {
+    
+    /// Moves the objects into new storage of `newCapacity` slots, without the holes.
+    
+    __strong id *newSlots = (__strong id *)calloc(newCapacity, sizeof(id));
+    QueueHandle *newSeqs = calloc(newCapacity, sizeof(QueueHandle));
+    
+    uint64_t newSize = 0;
+    for (uint64_t i = 0; i < _size; i++) {
+        if (slotAt(i) == nil) continue;
+        newSlots[newSize] = slotAt(i);
+        newSeqs[newSize] = seqAt(i);
+        slotAt(i) = nil;
+        newSize += 1;
+    }
+    assert((int64_t)newSize == _count);
+    
+    free(_slots);
+    free(_seqs);
+    _slots = newSlots;
+    _seqs = newSeqs;
+    _capacity = newCapacity;
+    _head = 0;
+    _size = newSize;
+}
+
+- (void)compactInPlace {
+    
+    /// Moves the objects towards the head, over the holes. (Reading index `i` is always >= the writing index `newSize`, so we never overwrite an object that we still have to move.)
+    
+    uint64_t newSize = 0;
+    for (uint64_t i = 0; i < _size; i++) {
+        if (slotAt(i) == nil) continue;
+        if (i != newSize) {
+            slotAt(newSize) = slotAt(i);
+            seqAt(newSize) = seqAt(i);
+            slotAt(i) = nil;
+        }
+        newSize += 1;
+    }
+    assert((int64_t)newSize == _count);
+    
+    _size = newSize;
+}
+
+///
+/// Interface
+///
+
+- (QueueHandle)enqueue:(id)obj {
+    
+    assert(obj != nil);
+    
+    /// Make room
+    ///     Only grow if the ring would still be more than half full after dropping the holes. Otherwise compacting frees enough slots that the next compaction is far away.
+    if (_size == _capacity) {
+        if ((uint64_t)_count > _capacity / 2) {
+            [self compactIntoCapacity:_capacity * 2];
+        } else {
+            [self compactInPlace];
+        }
+    }
+    
+    QueueHandle handle = _nextSeq;
+    slotAt(_size) = obj;
+    seqAt(_size) = handle;
+    _size += 1;
+    _count += 1;
+    _nextSeq += 1;
+    
+    return handle;
 }
 - (id)dequeue {
-    id obj = [_storage lastObject];
-    [_storage removeLastObject];
+    if (_count == 0) return nil;
+    id obj = slotAt(0);
+    slotAt(0) = nil;
+    _count -= 1;
+    [self dropHolesAtHead];
     return obj;
 }
 - (id)peek {
-    return [_storage lastObject];
+    if (_count == 0) return nil;
+    return slotAt(0); /// There are never holes at the head
 }
 - (BOOL)isEmpty {
-    return _storage.count == 0;
+    return _count == 0;
 }
 - (int64_t)count {
-    return _storage.count;
+    return _count;
 }
 
 - (NSArray *)dequeueAll {
-    NSArray *result = [[_storage reverseObjectEnumerator] allObjects]; /// This also copies the object which I think is important so outsiders can't manipulate our `_storage`
-    [_storage removeAllObjects];
+    NSArray *result = [self peekAll]; /// This copies the objects which I think is important so outsiders can't manipulate our storage
+    [self removeAllObjects];
     return result;
 }
 
 - (NSArray *)peekAll {
-    NSArray *result = [[_storage reverseObjectEnumerator] allObjects];
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:_count];
+    [self enumerateObjectsUsingBlock:^(id obj, QueueHandle handle, BOOL *stop) {
+        [result addObject:obj];
+    }];
     return result;
 }
 
-- (NSMutableArray *)_rawStorage { /// For outsiders to directly manipulate the underlying storage. Should probably not use `Queue` if this is necessary.
-    return _storage;
+- (id)objectForHandle:(QueueHandle)handle {
+    uint64_t i = [self indexForHandle:handle];
+    if (i == _size) return nil;
+    return slotAt(i);
 }
 
+- (void)removeObjectWithHandle:(QueueHandle)handle {
+    uint64_t i = [self indexForHandle:handle];
+    if (i == _size) return;
+    if (slotAt(i) == nil) return;
+    slotAt(i) = nil;
+    _count -= 1;
+    [self dropHolesAtHead];
+}
+
+- (void)removeAllObjects {
+    for (uint64_t i = 0; i < _size; i++) {
+        slotAt(i) = nil;
+    }
+    _head = 0;
+    _size = 0; /// Don't reset `_nextSeq`, so that old handles stay invalid
+    _count = 0;
+}
+
+- (void)enumerateObjectsUsingBlock:(void (^)(id obj, QueueHandle handle, BOOL *stop))block {
+    
+    /// Enumerates the objects without copying them.
+    ///     Mutating the queue inside the block is not supported.
+    
+    BOOL stop = NO;
+    for (uint64_t i = 0; i < _size; i++) {
+        id obj = slotAt(i);
+        if (obj == nil) continue; /// Skip holes
+        block(obj, seqAt(i), &stop);
+        if (stop) break;
+    }
+}
+
+- (NSString *)description {
+    return [[self peekAll] description];
+}
+
+#undef physicalIndex
+#undef slotAt
+#undef seqAt
+
 @end
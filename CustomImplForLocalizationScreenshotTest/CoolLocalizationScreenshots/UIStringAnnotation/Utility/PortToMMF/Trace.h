@@ -0,0 +1,66 @@
+//
+//  Trace.h
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 25.07.24.
+//
+
+/// Explanation:
+/// Replacement for the NSLogs in the swizzling and uiString-change code, which were slowing down capture runs a lot.
+/// `MFTrace()` only checks the verbosity level and copies a small fixed-size struct into a ring buffer for the current thread. A background queue writes the events to `MFTraceFilePath()` as text every 100 ms.
+///
+/// Notes:
+/// - If a thread's ring buffer is full, its new events are dropped. The writer logs how many.
+/// - The levels are the `MFVerbosity` levels.
+
+#import <Foundation/Foundation.h>
+#import "Utility.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+/// Events
+///
+
+typedef NS_ENUM(uint16_t, MFTraceEventType) {
+    MFTraceEventMessage = 0,                    /// text: message
+    MFTraceEventSwizzle = 1,                    /// arg0: Class, arg1: SEL
+    MFTraceEventSwizzleIncludingSubclasses = 2, /// arg0: Class, arg1: SEL
+    MFTraceEventUIStringChange = 3,             /// arg0: object, arg1: recursionDepth, arg2: 1 if we're waiting for the next recursion, text: description of the change
+    MFTraceEventLocalizedStringRecord = 4,      /// arg0: number of entries in `NSLocalizedStringRecord.queue`, text: the string that is about to be matched
+};
+
+typedef struct {
+    uint64_t timestamp; /// mach_absolute_time()
+    uint64_t threadID;  /// pthread_threadid_np()
+    uint16_t type;      /// MFTraceEventType
+    uint8_t level;      /// MFVerbosity
+    uint8_t textLength;
+    uint32_t _reserved;
+    uint64_t args[3];
+    char text[80];      /// Truncated, not null-terminated
+} MFTraceEvent;
+
+///
+/// Recording
+///
+
+#define MFTraceIsEnabled(__level) MFVerbosityIsEnabled(__level)
+
+#define MFTrace(__level, __type, __arg0, __arg1, __arg2, __text) \
+    do { \
+        if (MFTraceIsEnabled(__level)) { \
+            MFTraceRecord((__level), (__type), (uint64_t)(__arg0), (uint64_t)(__arg1), (uint64_t)(__arg2), (__text)); \
+        } \
+    } while (0)
+
+void MFTraceRecord(MFVerbosity level, MFTraceEventType type, uint64_t arg0, uint64_t arg1, uint64_t arg2, const char *_Nullable text); /// Use the `MFTrace()` macro instead, so the arguments aren't evaluated when the level is disabled.
+
+///
+/// Output
+///
+
+NSString *MFTraceFilePath(void);
+void MFTraceFlush(void); /// Blocks until all the events recorded so far have been written to the trace file
+
+NS_ASSUME_NONNULL_END
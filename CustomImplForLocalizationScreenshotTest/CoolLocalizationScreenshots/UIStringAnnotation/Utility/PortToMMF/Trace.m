@@ -0,0 +1,223 @@
+//
+//  Trace.m
+//  CustomImplForLocalizationScreenshotTest
+//
+//  Created by Noah Nübling on 25.07.24.
+//
+
+///
+/// Implementation notes:
+///     Each thread gets its own ring buffer the first time it records an event. The recording thread is the only one that writes `head` and the writer is the only one that writes `tail`,
+///     so a single-producer / single-consumer ring with atomic head and tail is enough, and recording never blocks.
+///     The rings are kept in a lock-free linked list which the writer walks. Rings are never freed - even after their thread exits - since the writer might still be reading them. That's ok since we only have a handful of threads.
+///
+
+#import "Trace.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <mach/mach_time.h>
+@import ObjectiveC.runtime;
+
+#define MFTraceRingCapacity 1024 /// Must be a power of 2
+
+typedef struct MFTraceRing {
+    MFTraceEvent events[MFTraceRingCapacity];
+    _Atomic uint64_t head;
+    _Atomic uint64_t tail;
+    _Atomic uint64_t droppedCount;
+    uint64_t reportedDroppedCount; /// Only accessed by the writer
+    uint64_t threadID;
+    struct MFTraceRing *next;
+} MFTraceRing;
+
+static _Thread_local MFTraceRing *_threadRing = NULL;
+static _Atomic(MFTraceRing *) _rings = NULL;
+
+static dispatch_queue_t _writerQueue;
+static dispatch_source_t _writerTimer;
+static FILE *_traceFile;
+static uint64_t _startTime;
+static mach_timebase_info_data_t _timebase;
+
+static void startWriter(void);
+static void drainRings(void);
+
+#pragma mark - Recording
+
+static MFTraceRing *currentThreadRing(void) {
+
+    if (_threadRing != NULL) return _threadRing;
+
+    startWriter();
+
+    MFTraceRing *ring = calloc(1, sizeof(MFTraceRing));
+    pthread_threadid_np(NULL, &ring->threadID);
+
+    /// Publish the ring to the writer
+    MFTraceRing *oldHead = atomic_load(&_rings);
+    do {
+        ring->next = oldHead;
+    } while (!atomic_compare_exchange_weak(&_rings, &oldHead, ring));
+
+    _threadRing = ring;
+    return ring;
+}
+
+static size_t utf8TruncationLength(const char *text, size_t length) {
+    
+    /// Returns the length to cut `text` to, so we don't cut a multi-byte UTF-8 sequence in half. (Otherwise the text isn't valid UTF-8 and the conversion to NSString fails when we write the trace.)
+    ///     We go back to the lead byte of the last sequence, and drop the sequence if it doesn't fully fit within `length`.
+    
+    size_t start = length;
+    while (start > 0 && ((uint8_t)text[start - 1] & 0xC0) == 0x80) start--; /// Skip continuation bytes (0b10xxxxxx)
+    if (start == 0) return 0;
+    start--; /// The lead byte
+    
+    uint8_t lead = (uint8_t)text[start];
+    size_t sequenceLength =
+        lead < 0x80 ? 1 :
+        (lead & 0xE0) == 0xC0 ? 2 :
+        (lead & 0xF0) == 0xE0 ? 3 :
+        (lead & 0xF8) == 0xF0 ? 4 : 1; /// Invalid lead byte - leave it as it is
+    
+    return start + sequenceLength <= length ? length : start;
+}
+
+void MFTraceRecord(MFVerbosity level, MFTraceEventType type, uint64_t arg0, uint64_t arg1, uint64_t arg2, const char *text) {
+
+    MFTraceRing *ring = currentThreadRing();
+
+    /// Drop the event if the ring is full
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= MFTraceRingCapacity) {
+        atomic_fetch_add_explicit(&ring->droppedCount, 1, memory_order_relaxed);
+        return;
+    }
+
+    /// Fill in the event
+    MFTraceEvent *event = &ring->events[head & (MFTraceRingCapacity - 1)];
+    event->timestamp = mach_absolute_time();
+    event->threadID = ring->threadID;
+    event->type = type;
+    event->level = (uint8_t)level;
+    event->args[0] = arg0;
+    event->args[1] = arg1;
+    event->args[2] = arg2;
+    event->textLength = 0;
+    if (text != NULL) {
+        size_t length = strnlen(text, sizeof(event->text));
+        if (length == sizeof(event->text) && text[length] != '\0') {
+            length = utf8TruncationLength(text, length);
+        }
+        memcpy(event->text, text, length);
+        event->textLength = (uint8_t)length;
+    }
+
+    /// Publish the event to the writer
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+#pragma mark - Writer
+
+NSString *MFTraceFilePath(void) {
+    static NSString *_path;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"MFTrace-%d.log", NSProcessInfo.processInfo.processIdentifier]];
+    });
+    return _path;
+}
+
+static void startWriter(void) {
+
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+
+        _startTime = mach_absolute_time();
+        mach_timebase_info(&_timebase);
+
+        _traceFile = fopen(MFTraceFilePath().fileSystemRepresentation, "w");
+        if (_traceFile == NULL) {
+            NSLog(@"Trace: Error: Couldn't open trace file at %@", MFTraceFilePath());
+        } else {
+            NSLog(@"Trace: Writing trace to %@", MFTraceFilePath());
+        }
+
+        _writerQueue = dispatch_queue_create("com.nuebling.mftrace-writer", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _writerTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _writerQueue);
+        dispatch_source_set_timer(_writerTimer, dispatch_time(DISPATCH_TIME_NOW, 100 * NSEC_PER_MSEC), 100 * NSEC_PER_MSEC, 50 * NSEC_PER_MSEC);
+        dispatch_source_set_event_handler(_writerTimer, ^{
+            drainRings();
+        });
+        dispatch_resume(_writerTimer);
+        
+        /// Write the last events on exit
+        ///     Otherwise we'd lose up to 100 ms of events - which are usually the ones you want to see.
+        atexit(MFTraceFlush);
+    });
+}
+
+void MFTraceFlush(void) {
+    if (_writerQueue == nil) return; /// Nothing has been recorded yet
+    dispatch_sync(_writerQueue, ^{
+        drainRings();
+    });
+}
+
+static void writeEvent(const MFTraceEvent *event) {
+
+    /// Note: Class and SEL pointers stay valid for the lifetime of the process, so we can look up their names here. Object pointers are only printed.
+
+    double milliseconds = (double)((event->timestamp - _startTime) * _timebase.numer / _timebase.denom) / NSEC_PER_MSEC;
+    int textLength = event->textLength;
+    const char *text = event->text;
+
+    fprintf(_traceFile, "[%10.3f ms] [thread %llu] [level %d] ", milliseconds, event->threadID, event->level);
+
+    switch ((MFTraceEventType)event->type) {
+        case MFTraceEventMessage:
+            fprintf(_traceFile, "%.*s\n", textLength, text);
+            break;
+        case MFTraceEventSwizzle:
+            fprintf(_traceFile, "Swizzling [%s %s]\n", class_getName((Class)event->args[0]), sel_getName((SEL)event->args[1]));
+            break;
+        case MFTraceEventSwizzleIncludingSubclasses:
+            fprintf(_traceFile, "Swizzling [%s %s] including subclasses\n", class_getName((Class)event->args[0]), sel_getName((SEL)event->args[1]));
+            break;
+        case MFTraceEventUIStringChange:
+            fprintf(_traceFile, "UIStringChangeDetector: %.*s (recursionDepth %llu) (on %p)%s\n", textLength, text, event->args[1], (void *)event->args[0], event->args[2] ? " --- Waiting for next recursion" : "");
+            break;
+        case MFTraceEventLocalizedStringRecord:
+            fprintf(_traceFile, "UIStringChangeDetector: LocalizedStringRecord has %llu entries before removing matched string (%.*s)\n", event->args[0], textLength, text);
+            break;
+        default:
+            fprintf(_traceFile, "Unknown event type %d\n", event->type);
+            break;
+    }
+}
+
+static void drainRings(void) {
+
+    if (_traceFile == NULL) return;
+
+    for (MFTraceRing *ring = atomic_load(&_rings); ring != NULL; ring = ring->next) {
+
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        for (; tail < head; tail++) {
+            writeEvent(&ring->events[tail & (MFTraceRingCapacity - 1)]);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        /// Report dropped events
+        uint64_t droppedCount = atomic_load_explicit(&ring->droppedCount, memory_order_relaxed);
+        if (droppedCount != ring->reportedDroppedCount) {
+            fprintf(_traceFile, "[thread %llu] Dropped %llu events since the ring buffer was full\n", ring->threadID, droppedCount - ring->reportedDroppedCount);
+            ring->reportedDroppedCount = droppedCount;
+        }
+    }
+
+    fflush(_traceFile);
+}
@@ -67,13 +67,46 @@ void swizzleMethodOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSear
 #define UNPACK(args...) args /// This allows us to include `,` inside an argument to a macro (but the argument then needs to be wrapped inside `()` by the caller of the macro )
 #define APPEND_ARGS(args...) , ## args /// This is like UNPACK but it also automatically inserts a comma before the args. The ## deletes the comma, if `args` is empty. I have no idea why. But this lets us nicely append args to an existing list of arguments in a function call or function header.
 
+#pragma mark - Verbosity
+
+/// Verbosity
+///     Expensive debug output (like dumping the whole nib decoder tree) should only be produced when the verbosity is high enough.
+///     Set it with the `MFVerbosity` user default - e.g. by passing `-MFVerbosity 3` as a launch argument. Defaults to `MFVerbosityNormal`.
+
+typedef NS_ENUM(NSInteger, MFVerbosity) {
+    MFVerbosityQuiet = 0,
+    MFVerbosityNormal = 1,
+    MFVerbosityVerbose = 2,
+    MFVerbosityDebug = 3,
+};
+
+MFVerbosity currentVerbosity(void);
+#define MFVerbosityIsEnabled(__verbosity) (currentVerbosity() >= (__verbosity))
+
 #pragma mark - Recursions
 
-void countRecursions(id recursionDepthKey, void (^workload)(NSInteger recursionDepth));
+/// Thread-local counters
+///     Fixed set of per-thread integer counters, for tracking recursion / nesting depth on hot paths.
+///     We used to keep these in an NSMutableDictionary inside the `threadDictionary`, which meant two threadDictionary lookups, a dictionary lookup, and NSNumber boxing every time we entered and left a counted scope.
+///     Now each counter is a slot in a `_Thread_local` array, so reading or changing it is just a memory access.
+///     To add a counter, add a case to the `MFThreadCounter` enum.
+
+typedef NS_ENUM(NSInteger, MFThreadCounter) {
+    MFThreadCounterUIStringChanges,
+    MFThreadCounterLoadNib,
+    MFThreadCounterNibDecoder,
+    MFThreadCounterSystemRename,
+    kMFThreadCounterCount,
+};
+
+void countRecursions(MFThreadCounter counter, void (^workload)(NSInteger recursionDepth));
+void countRecursionsWithKey(id recursionDepthKey, void (^workload)(NSInteger recursionDepth)); /// Slower, but works with dynamic keys
 
 #pragma mark - Parse format strings
 
+NSRegularExpression *formatSpecifierRegex(void);
 NSRegularExpression *formatStringRecognizer(NSString *formatString);
+NSArray<NSString *> *formatStringLiteralSegments(NSString *formatString);
 
 #pragma mark - objc introspection
 
@@ -82,4 +115,31 @@ void printClassHierarchy(NSObject *obj);
 
 @end
 
+#pragma mark - Thread-local counters
+///     (See `MFThreadCounter`. This is outside the `@interface` since it contains function definitions)
+
+extern _Thread_local NSInteger _MFThreadCounters[kMFThreadCounterCount];
+
+static inline NSInteger MFThreadCounterGet(MFThreadCounter counter) {
+    return _MFThreadCounters[counter];
+}
+static inline NSInteger MFThreadCounterIncrement(MFThreadCounter counter) { /// Returns the value before incrementing
+    return _MFThreadCounters[counter]++;
+}
+static inline void MFThreadCounterDecrement(MFThreadCounter counter) {
+    assert(_MFThreadCounters[counter] > 0);
+    _MFThreadCounters[counter]--;
+}
+
+/// Scoped guard
+///     Increments the counter and stores the previous value in a new variable called `__depthVariable`. The counter is decremented automatically when the current scope ends - also on early returns.
+///     Usage: `MFThreadCounterScope(MFThreadCounterLoadNib, depth);`
+
+static inline void _MFThreadCounterScopeEnd(MFThreadCounter *counter) {
+    MFThreadCounterDecrement(*counter);
+}
+#define MFThreadCounterScope(__counter, __depthVariable) \
+    NSInteger __depthVariable = MFThreadCounterIncrement(__counter); \
+    __attribute__((cleanup(_MFThreadCounterScopeEnd), unused)) MFThreadCounter _MFThreadCounterScopeGuard_##__depthVariable = (__counter);
+
 NS_ASSUME_NONNULL_END
@@ -14,6 +14,8 @@
 #import "AppKitIntrospection.h"
 #import "dlfcn.h"
 #import "mach-o/dyld.h"
+#import "LRUCache.h"
+#import "Trace.h"
 //#import "execinfo.h"
 
 @implementation Utility
@@ -46,7 +48,7 @@ void swizzleMethod(Class class, SEL selector, InterceptorFactory interceptorFact
     ///     You can get the metaclass of a class `baseClass` by calling `object_getClass(baseClass)`.
     
     /// Log
-    NSLog(@"Swizzling [%s %s]", class_getName(class), sel_getName(selector));
+    MFTrace(MFVerbosityVerbose, MFTraceEventSwizzle, class, selector, 0, NULL);
     
     /// Validate
     ///     Make sure `selector` is defined on class or one of its superclasses.
@@ -78,26 +80,163 @@ void swizzleMethod(Class class, SEL selector, InterceptorFactory interceptorFact
     assert(previousImplementation == originalImplementation);
 }
 
+///
+/// Batched swizzling
+///
+///     `swizzleMethodOnClassAndSubclasses()` is called ~45 times from various `+load` methods. Each call used to run its own `searchClasses()` - which resolves the framework path via dlopen/dlclose and then enumerates all the classes in the framework.
+///     Now, calls made during `+load` are only recorded, and then all of them are installed at once in `flushSwizzleRequests()`, which runs as a constructor. (dyld runs all the `+load` methods of an image before its constructors, so this still happens before `main()`.)
+///     When flushing, we enumerate the classes of each framework only once, and then find the subclasses for each request by walking the superclass chains of those classes.
+///     The requests are installed in the order they were made, and the `classInheritsMethod()` checks for each request run right before it is installed - just like before - so hooking the same selector several times still nests the interceptors in the same order.
+///     Calls made after the flush are installed immediately.
+///
+
+@interface SwizzleRequest : NSObject {
+    @public
+    Class _baseClass;
+    NSDictionary<MFClassSearchCriterion, id> *_subclassSearchCriteria;
+    SEL _selector;
+    InterceptorFactory _interceptorFactory;
+}
+@end
+@implementation SwizzleRequest
+@end
+
+bool classIsSubclass(Class potentialSub, Class potentialSuper);
+
+static NSMutableArray<SwizzleRequest *> *_pendingSwizzleRequests = nil;
+static BOOL _swizzleRequestsWereFlushed = NO;
+
+static NSArray<Class> *installSwizzleOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSearchCriterion, id> *subclassSearchCriteria, SEL selector, InterceptorFactory interceptorFactory, NSArray<Class> *_Nullable frameworkClasses);
+static NSArray<NSArray<Class> *> *_Nullable loadCachedSwizzlePlan(NSArray<SwizzleRequest *> *requests);
+static void storeSwizzlePlan(NSArray<SwizzleRequest *> *requests, NSArray<NSArray<Class> *> *plan);
+
 void swizzleMethodOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSearchCriterion, id> *subclassSearchCriteria, SEL selector, InterceptorFactory interceptorFactory) {
 
     /// Log
-    NSLog(@"Swizzling [%s %s] including subclasses. subclassSearchCriteria: %@ (Class is in %s)", class_getName(baseClass), sel_getName(selector), subclassSearchCriteria, class_getImageName(baseClass));
+    MFTrace(MFVerbosityVerbose, MFTraceEventSwizzleIncludingSubclasses, baseClass, selector, 0, NULL);
     
     /// Validate args
     assert(baseClass != nil);
     assert(interceptorFactory != nil);
-    
-    /// Preprocess classSearchCriteria
     assert([subclassSearchCriteria isKindOfClass:[NSDictionary class]]);
-    NSMutableDictionary *classSearchCriteria = subclassSearchCriteria.mutableCopy;
-    assert(classSearchCriteria[MFClassSearchCriterionSuperclass] == nil);
-    classSearchCriteria[MFClassSearchCriterionSuperclass] = baseClass;
+    
+    /// Install right away
+    if (_swizzleRequestsWereFlushed) {
+        installSwizzleOnClassAndSubclasses(baseClass, subclassSearchCriteria, selector, interceptorFactory, nil);
+        return;
+    }
+    
+    /// Record request
+    ///     It will be installed in `flushSwizzleRequests()`
+    if (_pendingSwizzleRequests == nil) {
+        _pendingSwizzleRequests = [NSMutableArray array];
+    }
+    SwizzleRequest *request = [[SwizzleRequest alloc] init];
+    request->_baseClass = baseClass;
+    request->_subclassSearchCriteria = subclassSearchCriteria;
+    request->_selector = selector;
+    request->_interceptorFactory = interceptorFactory;
+    [_pendingSwizzleRequests addObject:request];
+}
+
+__attribute__((constructor))
+static void flushSwizzleRequests(void) {
+    
+    /// Validate
+    assert(NSThread.isMainThread);
+    assert(!_swizzleRequestsWereFlushed);
+    
+    @autoreleasepool {
+        
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        
+        /// Use cached plan
+        ///     See `loadCachedSwizzlePlan()`
+        NSArray<NSArray<Class> *> *cachedPlan = loadCachedSwizzlePlan(_pendingSwizzleRequests);
+        if (cachedPlan != nil) {
+            
+            /// Install
+            [_pendingSwizzleRequests enumerateObjectsUsingBlock:^(SwizzleRequest *request, NSUInteger i, BOOL *stop) {
+                for (Class class in cachedPlan[i]) {
+                    swizzleMethod(class, request->_selector, request->_interceptorFactory);
+                }
+            }];
+            
+            /// Log
+            if (MFVerbosityIsEnabled(MFVerbosityVerbose)) {
+                NSLog(@"Swizzling: Installed %lu batched swizzle requests from the cached plan in %.1f ms", (unsigned long)_pendingSwizzleRequests.count, (CFAbsoluteTimeGetCurrent() - startTime) * 1000.0);
+            }
+            
+            /// Update state
+            _pendingSwizzleRequests = nil;
+            _swizzleRequestsWereFlushed = YES;
+            return;
+        }
+        
+        /// Enumerate the classes of each framework once
+        ///     Requests that use other search criteria besides the framework (name prefix, protocol) are rare. For them we pass nil so they do their own search.
+        NSMutableDictionary<NSString *, NSArray<Class> *> *classesByFramework = [NSMutableDictionary dictionary];
+        NSMutableArray<NSArray<Class> *> *plan = [NSMutableArray array];
+        
+        for (SwizzleRequest *request in _pendingSwizzleRequests) {
+            
+            NSArray<Class> *frameworkClasses = nil;
+            NSString *frameworkName = request->_subclassSearchCriteria[MFClassSearchCriterionFrameworkName];
+            BOOL onlyFilterByFramework = frameworkName.length > 0 && request->_subclassSearchCriteria.count == 1; /// An empty frameworkName means 'all frameworks'. Enumerating all of those without filtering by superclass would be slow, so we let the request do its own search.
+            
+            if (onlyFilterByFramework) {
+                frameworkClasses = classesByFramework[frameworkName];
+                if (frameworkClasses == nil) {
+                    frameworkClasses = searchClasses(@{ MFClassSearchCriterionFrameworkName: frameworkName });
+                    classesByFramework[frameworkName] = frameworkClasses;
+                }
+            }
+            
+            NSArray<Class> *swizzledClasses = installSwizzleOnClassAndSubclasses(request->_baseClass, request->_subclassSearchCriteria, request->_selector, request->_interceptorFactory, frameworkClasses);
+            [plan addObject:swizzledClasses];
+        }
+        
+        /// Cache the plan for the next launch
+        storeSwizzlePlan(_pendingSwizzleRequests, plan);
+        
+        /// Log
+        if (MFVerbosityIsEnabled(MFVerbosityVerbose)) {
+            NSLog(@"Swizzling: Installed %lu batched swizzle requests in %.1f ms (enumerated %lu frameworks)", (unsigned long)_pendingSwizzleRequests.count, (CFAbsoluteTimeGetCurrent() - startTime) * 1000.0, (unsigned long)classesByFramework.count);
+        }
+        
+        /// Update state
+        _pendingSwizzleRequests = nil;
+        _swizzleRequestsWereFlushed = YES;
+    }
+}
+
+static NSArray<Class> *installSwizzleOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSearchCriterion, id> *subclassSearchCriteria, SEL selector, InterceptorFactory interceptorFactory, NSArray<Class> *_Nullable frameworkClasses) {
+    
+    /// Returns the classes that were swizzled, in the order they were swizzled.
     
     /// Find subclasses
-    NSArray<Class> *subclasses = searchClasses(classSearchCriteria);
+    NSArray<Class> *subclasses;
+    if (frameworkClasses != nil) {
+        /// Filter the pre-enumerated classes
+        ///     We filter out `baseClass` itself since it's swizzled separately below.
+        NSMutableArray *filtered = [NSMutableArray array];
+        for (Class class in frameworkClasses) {
+            if (class != baseClass && classIsSubclass(class, baseClass)) {
+                [filtered addObject:class];
+            }
+        }
+        subclasses = filtered;
+    } else {
+        /// Preprocess classSearchCriteria
+        NSMutableDictionary *classSearchCriteria = subclassSearchCriteria.mutableCopy;
+        assert(classSearchCriteria[MFClassSearchCriterionSuperclass] == nil);
+        classSearchCriteria[MFClassSearchCriterionSuperclass] = baseClass;
+        /// Search
+        subclasses = searchClasses(classSearchCriteria);
+    }
     
-    /// Declare validation state
-    BOOL someClassHasBeenSwizzled = NO;
+    /// Declare result
+    NSMutableArray<Class> *swizzledClasses = [NSMutableArray array];
     
     /// Swizzle subclasses
     for (Class subclass in subclasses) {
@@ -109,7 +248,7 @@ void swizzleMethodOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSear
         
         /// Swizzle
         swizzleMethod(subclass, selector, interceptorFactory);
-        someClassHasBeenSwizzled = YES;
+        [swizzledClasses addObject:subclass];
     }
     
     /// Swizzle on baseClass
@@ -119,17 +258,227 @@ void swizzleMethodOnClassAndSubclasses(Class baseClass, NSDictionary<MFClassSear
     
     if ([baseClass instancesRespondToSelector:selector]) {
         swizzleMethod(baseClass, selector, interceptorFactory);
-        someClassHasBeenSwizzled = YES;
+        [swizzledClasses addObject:baseClass];
     }
     
     /// Validate
-    if (!someClassHasBeenSwizzled) {
+    if (swizzledClasses.count == 0) {
         NSLog(@"Error: Neither %@ nor any of the subclasses we found for it (%@) have been swizzled. This is probably because none of the processed classes implement a method for selector %s. We used the search criteria: %@", baseClass, subclasses, sel_getName(selector), subclassSearchCriteria);
         assert(false);
     }
     
+    /// Return
+    return swizzledClasses;
+}
+
+///
+/// Swizzle plan cache
+///
+///     We launch the app hundreds of times per localization run, and each launch would enumerate the same framework classes to find the same classes to swizzle.
+///     So after installing the swizzles, we store the 'plan' - which classes were swizzled for which request - in the Caches directory. On the next launch we install the swizzles straight from the plan, without enumerating any classes.
+///
+///     The plan is only valid if nothing that it was derived from has changed:
+///     - The swizzle requests (base class, selector, all search criteria values - in order)
+///     - The macOS version
+///     - The binaries that the class searches looked at, including the main executable. We compare the LC_UUID of each of these images against the one we stored. (See `searchedImagePaths()`)
+///     On top of that, before installing anything, we check that every class in the plan still exists and responds to the selector. If any check fails, we ignore the cache and search the classes like normal - which also overwrites the cache.
+///
+///     File format: A plist dictionary with these keys:
+///     - `version`:        Format version (NSNumber)
+///     - `osVersion`:      NSProcessInfo.operatingSystemVersionString
+///     - `requests`:       One string per request, see `swizzleRequestSignature()`
+///     - `images`:         Image path -> LC_UUID string, for all the searched images
+///     - `plan`:           One array of class names per request. Metaclasses are prefixed with `+`.
+///
+
+#define MFSwizzlePlanCacheVersion 2
+
+static NSString *swizzlePlanCachePath(void) {
+    NSString *cachesDir = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    NSString *bundleID = NSBundle.mainBundle.bundleIdentifier ?: @"CustomImplForLocalizationScreenshotTest";
+    return [[cachesDir stringByAppendingPathComponent:bundleID] stringByAppendingPathComponent:@"SwizzlePlan.plist"];
+}
+
+static NSString *classNameForPlan(Class class) {
+    return [NSString stringWithFormat:@"%s%s", class_isMetaClass(class) ? "+" : "", class_getName(class)];
+}
+static Class _Nullable classFromPlan(NSString *name) {
+    if ([name hasPrefix:@"+"]) {
+        return objc_getMetaClass([[name substringFromIndex:1] UTF8String]);
+    }
+    return objc_getClass(name.UTF8String);
+}
+
+static NSString *swizzleRequestSignature(SwizzleRequest *request) {
+    
+    /// Describe the search criteria
+    ///     Sorted by key so the signature doesn't depend on the dictionary order.
+    NSMutableArray<NSString *> *criteria = [NSMutableArray array];
+    for (MFClassSearchCriterion key in [request->_subclassSearchCriteria.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        id value = request->_subclassSearchCriteria[key];
+        NSString *valueDescription;
+        if ([value isKindOfClass:[Protocol class]])         valueDescription = @(protocol_getName(value));
+        else if (object_isClass(value))                     valueDescription = classNameForPlan(value);
+        else                                                valueDescription = [value description];
+        [criteria addObject:[NSString stringWithFormat:@"%@=%@", key, valueDescription]];
+    }
+    
+    return [NSString stringWithFormat:@"%@|%s|%@", classNameForPlan(request->_baseClass), sel_getName(request->_selector), [criteria componentsJoinedByString:@","]];
+}
+
+static NSSet<NSString *> *searchedImagePaths(NSArray<SwizzleRequest *> *requests) {
+    
+    /// Returns the paths of all the images that the class searches for the `requests` look at. If any of them change, the search might find different classes.
+    ///     Notes:
+    ///     - Requests without a framework criterion search *all* images, so then we return all the images that are loaded right now. That way we also notice when an image is added or removed.
+    ///     - The main executable is always included, since that's the image that changes the most during development.
+    ///     - We match frameworks by the `<name>.framework/` component, since the paths from dyld aren't the same as the ones from `searchFrameworkPath()` (dyld uses the `Versions/X/` path).
+    
+    NSMutableSet<NSString *> *result = [NSMutableSet set];
+    
+    /// Main executable
+    ///     dyld always lists the main executable first.
+    [result addObject:@(_dyld_get_image_name(0))];
+    
+    /// Collect the searched frameworks
+    NSMutableSet<NSString *> *frameworkComponents = [NSMutableSet set];
+    BOOL searchesAllImages = NO;
+    for (SwizzleRequest *request in requests) {
+        NSString *frameworkName = request->_subclassSearchCriteria[MFClassSearchCriterionFrameworkName];
+        if (frameworkName.length == 0) {
+            searchesAllImages = YES;
+        } else {
+            [frameworkComponents addObject:[NSString stringWithFormat:@"/%@.framework/", frameworkName]];
+        }
+        const char *baseClassImage = class_getImageName(request->_baseClass);
+        if (baseClassImage != NULL) [result addObject:@(baseClassImage)];
+    }
+    
+    /// Find their images
+    unsigned int imageCount;
+    const char **imageNames = objc_copyImageNames(&imageCount);
+    for (unsigned int i = 0; i < imageCount; i++) {
+        NSString *path = @(imageNames[i]);
+        BOOL isSearched = searchesAllImages;
+        for (NSString *component in frameworkComponents) {
+            if (isSearched) break;
+            isSearched = [path containsString:component];
+        }
+        if (isSearched) [result addObject:path];
+    }
+    free(imageNames);
+    
+    return result;
+}
+
+static NSDictionary<NSString *, NSString *> *uuidsOfLoadedImages(NSSet<NSString *> *imagePaths) {
+    
+    /// Returns the LC_UUID of each of the `imagePaths` that is currently loaded
+    
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    
+    uint32_t imageCount = _dyld_image_count();
+    for (uint32_t i = 0; i < imageCount; i++) {
+        
+        const char *imageName = _dyld_get_image_name(i);
+        NSString *path = @(imageName);
+        if (![imagePaths containsObject:path]) continue;
+        
+        const struct mach_header_64 *header = (const struct mach_header_64 *)_dyld_get_image_header(i);
+        if (header == NULL || header->magic != MH_MAGIC_64) continue;
+        
+        const struct load_command *command = (const struct load_command *)(header + 1);
+        for (uint32_t c = 0; c < header->ncmds; c++) {
+            if (command->cmd == LC_UUID) {
+                const struct uuid_command *uuidCommand = (const struct uuid_command *)command;
+                result[path] = [[NSUUID alloc] initWithUUIDBytes:uuidCommand->uuid].UUIDString;
+                break;
+            }
+            command = (const struct load_command *)((const char *)command + command->cmdsize);
+        }
+    }
+    
+    return result;
 }
 
+static NSArray<NSArray<Class> *> *_Nullable loadCachedSwizzlePlan(NSArray<SwizzleRequest *> *requests) {
+    
+    /// Load
+    NSDictionary *cache = [NSDictionary dictionaryWithContentsOfFile:swizzlePlanCachePath()];
+    if (cache == nil) return nil;
+    
+    /// Validate format and environment
+    if (![cache[@"version"] isEqual:@(MFSwizzlePlanCacheVersion)]) return nil;
+    if (![cache[@"osVersion"] isEqual:NSProcessInfo.processInfo.operatingSystemVersionString]) return nil;
+    
+    /// Validate requests
+    NSArray *cachedRequests = cache[@"requests"];
+    NSArray *cachedPlan = cache[@"plan"];
+    if (![cachedRequests isKindOfClass:[NSArray class]] || ![cachedPlan isKindOfClass:[NSArray class]]) return nil;
+    if (cachedRequests.count != requests.count || cachedPlan.count != requests.count) return nil;
+    for (NSUInteger i = 0; i < requests.count; i++) {
+        if (![cachedRequests[i] isEqual:swizzleRequestSignature(requests[i])]) return nil;
+    }
+    
+    /// Validate images
+    ///     Compare all the images that the search would look at - not just the ones we stored - so we also notice added images.
+    NSDictionary<NSString *, NSString *> *cachedImages = cache[@"images"];
+    if (![cachedImages isKindOfClass:[NSDictionary class]]) return nil;
+    NSDictionary<NSString *, NSString *> *currentImages = uuidsOfLoadedImages(searchedImagePaths(requests));
+    if (![currentImages isEqual:cachedImages]) return nil;
+    
+    /// Resolve classes
+    ///     Resolve everything before installing anything, so we never end up with a half-installed plan.
+    NSMutableArray<NSArray<Class> *> *plan = [NSMutableArray array];
+    for (NSUInteger i = 0; i < requests.count; i++) {
+        
+        NSArray<NSString *> *classNames = cachedPlan[i];
+        if (![classNames isKindOfClass:[NSArray class]] || classNames.count == 0) return nil;
+        
+        NSMutableArray<Class> *classes = [NSMutableArray array];
+        for (NSString *className in classNames) {
+            Class class = classFromPlan(className);
+            if (class == nil || ![class instancesRespondToSelector:requests[i]->_selector]) return nil;
+            [classes addObject:class];
+        }
+        [plan addObject:classes];
+    }
+    
+    /// Return
+    return plan;
+}
+
+static void storeSwizzlePlan(NSArray<SwizzleRequest *> *requests, NSArray<NSArray<Class> *> *plan) {
+    
+    /// Serialize
+    NSMutableArray *requestSignatures = [NSMutableArray array];
+    NSMutableArray *planNames = [NSMutableArray array];
+    
+    for (NSUInteger i = 0; i < requests.count; i++) {
+        [requestSignatures addObject:swizzleRequestSignature(requests[i])];
+        NSMutableArray *classNames = [NSMutableArray array];
+        for (Class class in plan[i]) {
+            [classNames addObject:classNameForPlan(class)];
+        }
+        [planNames addObject:classNames];
+    }
+    
+    NSDictionary *cache = @{
+        @"version": @(MFSwizzlePlanCacheVersion),
+        @"osVersion": NSProcessInfo.processInfo.operatingSystemVersionString,
+        @"requests": requestSignatures,
+        @"images": uuidsOfLoadedImages(searchedImagePaths(requests)), /// Needs to be the exact same set that `loadCachedSwizzlePlan()` compares against - otherwise the cache never validates
+        @"plan": planNames,
+    };
+    
+    /// Write
+    NSString *path = swizzlePlanCachePath();
+    [NSFileManager.defaultManager createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nil];
+    BOOL success = [cache writeToFile:path atomically:YES];
+    if (!success) {
+        NSLog(@"Swizzling: Warning: Couldn't write swizzle plan cache to %@", path);
+    }
+}
 
 #pragma mark - Runtime
 /// (Porting this to MMF)
@@ -305,6 +654,23 @@ const char *searchFrameworkPath(const char *frameworkName) {
     ///   entitlements, then all environment variables are ignored, and only a full
     ///   path can be used."
     
+    /// Check cache
+    ///     The search dlopens every candidate path, so we only want to do it once per framework.
+    ///     The cache is guarded by @synchronized since `swizzleMethodOnClassAndSubclasses()` can still call this from any thread after the swizzle requests were flushed. (Two threads might both search for the same framework, but that's harmless.)
+    static NSMutableDictionary<NSString *, NSValue *> *_cache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _cache = [NSMutableDictionary dictionary];
+    });
+    NSString *cacheKey = @(frameworkName);
+    NSValue *cachedPath;
+    @synchronized (_cache) {
+        cachedPath = _cache[cacheKey];
+    }
+    if (cachedPath != nil) {
+        return cachedPath.pointerValue;
+    }
+    
     /// Preprocess framework name
     char *frameworkSubpath = NULL;
     asprintf(&frameworkSubpath, "%s.framework/%s", frameworkName, frameworkName);
@@ -345,6 +711,9 @@ const char *searchFrameworkPath(const char *frameworkName) {
     
     /// Return frameworkPath
     if (result != NULL) {
+        @synchronized (_cache) {
+            _cache[cacheKey] = [NSValue valueWithPointer:result]; /// `result` is never freed, so it's ok to hand it out repeatedly
+        }
         return result;
     }
     
@@ -369,11 +738,15 @@ const char *searchFrameworkPath(const char *frameworkName) {
         }
     }
     
-    free(imagePaths);
+    free(imagePaths); /// Only frees the array. The path strings are owned by the objc runtime.
     
     if (result == NULL) {
         NSLog(@"Error: Couldn't find framework with name %s", frameworkName);
         assert(false);
+    } else {
+        @synchronized (_cache) {
+            _cache[cacheKey] = [NSValue valueWithPointer:result];
+        }
     }
     return result;
     
@@ -417,12 +790,36 @@ bool classIsSubclass(Class potentialSub, Class potentialSuper) {
     return false;
 }
 
+#pragma mark - Verbosity
+
+MFVerbosity currentVerbosity(void) {
+    
+    /// Notes:
+    /// - We only read the user default once, so this is cheap enough to call on hot paths.
+    /// - Launch arguments like `-MFVerbosity 3` end up in the NSArgumentDomain of the user defaults.
+    
+    static MFVerbosity _verbosity;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        id value = [NSUserDefaults.standardUserDefaults objectForKey:@"MFVerbosity"];
+        _verbosity = (value != nil) ? [value integerValue] : MFVerbosityNormal;
+    });
+    return _verbosity;
+}
+
 #pragma mark - Recursions
 /// (Porting this to MMF)
 
+_Thread_local NSInteger _MFThreadCounters[kMFThreadCounterCount] = { 0 };
+
+void countRecursions(MFThreadCounter counter, void (^workload)(NSInteger recursionDepth)) {
+    MFThreadCounterScope(counter, depth);
+    workload(depth);
+}
+
 #define MFRecursionCounterBaseKey @"MFRecursionCounterBaseKey"
 
-void countRecursions(id recursionDepthKey, void (^workload)(NSInteger recursionDepth)) {
+void countRecursionsWithKey(id recursionDepthKey, void (^workload)(NSInteger recursionDepth)) {
     NSInteger depth = recursionCounterBegin(recursionDepthKey);
     workload(depth);
     recursionCounterEnd(recursionDepthKey);
@@ -459,7 +856,7 @@ void _recursionSwitch(id selfKey, SEL _cmdKey, void (^onFirstRecursion)(void), v
     
     id key = stringf(@"%p|%s", selfKey, sel_getName(_cmdKey));
     
-    countRecursions(key, ^(NSInteger recursionDepth) {
+    countRecursionsWithKey(key, ^(NSInteger recursionDepth) {
         if (recursionDepth == 0) {
             onFirstRecursion();
         } else {
@@ -471,8 +868,23 @@ void _recursionSwitch(id selfKey, SEL _cmdKey, void (^onFirstRecursion)(void), v
 #pragma mark - Parse format strings
 /// (Porting this to MMF)
 
+static NSRegularExpression *_formatSpecifierRegex(void);
+static NSRegularExpression *_formatStringRecognizer(NSString *localizedString);
+
 NSRegularExpression *formatSpecifierRegex(void) {
     
+    /// Compile only once
+    ///     The pattern is quite large, and this is called every time we create a `formatStringRecognizer()`. NSRegularExpression is immutable and thread safe, so sharing it is fine.
+    static NSRegularExpression *_regex = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _regex = _formatSpecifierRegex();
+    });
+    return _regex;
+}
+
+static NSRegularExpression *_formatSpecifierRegex(void) {
+    
     /// Regex pattern that matches format specifiers such as %d in format strings.
     /// Notes:
     /// - \ and % are doubled to escape them.
@@ -537,6 +949,39 @@ NSRegularExpression *formatSpecifierRegex(void) {
 
 NSRegularExpression *formatStringRecognizer(NSString *localizedString) {
     
+    /// Returns a regex that matches any ui string which is composed of the `localizedString`.
+    ///
+    /// Caching:
+    ///     This is called for every partial-match attempt in `UIStringChangeDetector`, so it's called thousands of times with the same few localizedStrings.
+    ///     Compiling the regex is by far the slowest part of the matching, so we cache the compiled recognizers keyed by the localizedString.
+    ///     We use an LRUCache to bound the memory, since apps can have a very large number of distinct localizedStrings.
+    ///     The cache is guarded by @synchronized since we're not sure whether this is always called on the main thread.
+    
+    static LRUCache<NSString *, NSRegularExpression *> *_cache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _cache = [LRUCache cacheWithCountLimit:1000];
+    });
+    
+    NSRegularExpression *result;
+    @synchronized (_cache) {
+        result = [_cache objectForKey:localizedString];
+    }
+    if (result != nil) {
+        return result;
+    }
+    
+    result = _formatStringRecognizer(localizedString);
+    
+    @synchronized (_cache) {
+        [_cache setObject:result forKey:localizedString];
+    }
+    
+    return result;
+}
+
+static NSRegularExpression *_formatStringRecognizer(NSString *localizedString) {
+    
     /// TODO: FIX BUG: This function will treat escaped percent (%%) like a format specifer and replace it with with `.*`which is wrong.
     
     /// Turn the localizedString into a matching pattern
@@ -552,9 +997,6 @@ NSRegularExpression *formatStringRecognizer(NSString *localizedString) {
     ///     and capture everything except the literal chars from the localizedString inside the insertionPoint groups.
     localizedStringPattern = [NSString stringWithFormat:@"^%@%@%@$", insertionPoint, localizedStringPattern, insertionPoint];
     
-    /// TEST
-    NSLog(@"%@", localizedStringPattern);
-    
     /// Create regex
     ///     From new matching pattern
     NSRegularExpressionOptions regexOptions = NSRegularExpressionDotMatchesLineSeparators   /** Strings in insertion points might have linebreaks - still match those */
@@ -576,6 +1018,49 @@ NSRegularExpression *formatStringRecognizer(NSString *localizedString) {
     return resultRegex;
 }
 
+NSArray<NSString *> *formatStringLiteralSegments(NSString *formatString) {
+    
+    /// Splits the formatString at its format specifiers and returns the literal text between them.
+    ///     E.g. for `Hello %@, you have %d new messages` this returns `["Hello ", ", you have ", " new messages"]`
+    ///     Also splits at escaped percent (%%), which is consistent with how the `formatStringRecognizer()` currently handles it. (See the TODO in there)
+    ///
+    /// Use case:
+    ///     Any string that the `formatStringRecognizer(formatString)` matches must contain all of these literal segments in order. So we can use this as a cheap prefilter before running the regex.
+    ///     This is also cached, since it's called with the same few formatStrings over and over.
+    
+    static LRUCache<NSString *, NSArray<NSString *> *> *_cache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _cache = [LRUCache cacheWithCountLimit:1000];
+    });
+    
+    NSArray<NSString *> *result;
+    @synchronized (_cache) {
+        result = [_cache objectForKey:formatString];
+    }
+    if (result != nil) {
+        return result;
+    }
+    
+    NSMutableArray<NSString *> *segments = [NSMutableArray array];
+    __block NSUInteger segmentStart = 0;
+    NSMatchingOptions matchingOptions = NSMatchingWithoutAnchoringBounds; /// See `formatStringRecognizer()`
+    [formatSpecifierRegex() enumerateMatchesInString:formatString options:matchingOptions range:NSMakeRange(0, formatString.length) usingBlock:^(NSTextCheckingResult * _Nullable match, NSMatchingFlags flags, BOOL * _Nonnull stop) {
+        NSRange specifierRange = match.range;
+        [segments addObject:[formatString substringWithRange:NSMakeRange(segmentStart, specifierRange.location - segmentStart)]];
+        segmentStart = NSMaxRange(specifierRange);
+    }];
+    [segments addObject:[formatString substringFromIndex:segmentStart]];
+    
+    result = segments;
+    
+    @synchronized (_cache) {
+        [_cache setObject:result forKey:formatString];
+    }
+    
+    return result;
+}
+
 #pragma mark - objc inspection
 /// (Porting this to MMF)
 
@@ -5,7 +5,37 @@
 //  Created by Noah Nübling on 07.07.24.
 //
 
+/// Benchmarks for the annotation core
+///
+/// Corpus:
+///     The strings are loaded from the .xcstrings and .xliff files in the repo (found relative to this source file) and then scaled up synthetically to `kCorpusSize` strings,
+///     by appending numbers, wrapping them in markdown and concatenating them. That way the corpus has realistic content but is large enough that the caches (e.g. the LRUCache in `formatStringRecognizer()`) don't hide the real cost.
+///
+/// Results:
+///     The measurements end up in the .xcresult bundle of the test run, so they can be tracked across commits with `xcrun xcresulttool`. You can also set baselines for them in Xcode.
+
 #import <XCTest/XCTest.h>
+#import "Utility.h"
+#import "AnnotationUtility.h"
+#import "Queue.h"
+#import "ArenaTree.h"
+#import "KVPair.h"
+#import "AnnotationRecord.h"
+#import "CaptureRecording.h"
+#import "NSLocalizedStringRecord.h"
+
+#define kCorpusSize 5000
+#define kDecoderRecordSize 20000
+
+/// Forward declarations
+static void addDecoderRecordNode(NSMutableArray *decoderRecord, NSInteger depth, uint32_t *seed);
+static NSArray<NSString *> *stringsFromXCStrings(NSString *path);
+static NSArray<NSString *> *stringsFromXliff(NSString *path);
+
+/// Private interface
+@interface NSObject (AnnotatorBenchmarks)
++ (ArenaTree<KVPair *> *)treeFromDecoderRecord:(NSArray *)decoderRecord; /// Implemented on the `Annotator` class in NibDecodingAnalysis.m
+@end
 
 @interface CustomImplForLocalizationScreenshotTestTests : XCTestCase
 
@@ -13,23 +43,305 @@
 
 @implementation CustomImplForLocalizationScreenshotTestTests
 
-- (void)setUp {
-    // Put setup code here. This method is called before the invocation of each test method in the class.
+static NSArray<NSString *> *_corpus = nil;
+static NSArray<NSString *> *_formatStrings = nil;       /// Strings from the corpus that `formatStringRecognizer()` accepts
+static NSArray<NSString *> *_formattedStrings = nil;    /// `_formatStrings` with the format specifiers filled in
+static NSArray<NSDictionary *> *_decoderRecord = nil;
+
+#pragma mark - Corpus
+
++ (void)setUp {
+
+    /// Find source strings
+    NSString *repoPath = [[@(__FILE__) stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"../.."].stringByStandardizingPath;
+    NSMutableOrderedSet<NSString *> *sourceStrings = [NSMutableOrderedSet orderedSet];
+
+    NSDirectoryEnumerator *enumerator = [NSFileManager.defaultManager enumeratorAtPath:[repoPath stringByAppendingPathComponent:@"CustomImplForLocalizationScreenshotTest"]];
+    for (NSString *relativePath in enumerator) {
+        NSString *path = [repoPath stringByAppendingPathComponent:[@"CustomImplForLocalizationScreenshotTest" stringByAppendingPathComponent:relativePath]];
+        if ([relativePath.pathExtension isEqual:@"xcstrings"]) {
+            [sourceStrings addObjectsFromArray:stringsFromXCStrings(path)];
+        } else if ([relativePath.pathExtension isEqual:@"xliff"]) {
+            [sourceStrings addObjectsFromArray:stringsFromXliff(path)];
+        }
+    }
+    NSArray<NSString *> *baseStrings = [sourceStrings.array filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]];
+    if (baseStrings.count == 0) {
+        NSLog(@"Benchmarks: Warning: Couldn't find .xcstrings or .xliff files under %@. Using placeholder strings.", repoPath);
+        baseStrings = @[@"Hello", @"Open %@", @"%d files selected", @"**Bold** and _italic_", @"Show Spelling and Grammar", @"1.0"];
+    }
+
+    /// Scale up
+    NSMutableArray<NSString *> *corpus = [NSMutableArray arrayWithCapacity:kCorpusSize];
+    for (NSUInteger i = 0; i < kCorpusSize; i++) {
+        NSString *base = baseStrings[i % baseStrings.count];
+        NSUInteger variant = i / baseStrings.count;
+        switch (variant % 4) {
+            case 0: [corpus addObject:base]; break;
+            case 1: [corpus addObject:[NSString stringWithFormat:@"%@ %lu", base, (unsigned long)variant]]; break;
+            case 2: [corpus addObject:[NSString stringWithFormat:@"**%@** [link](https://example.com/%lu)", base, (unsigned long)variant]]; break;
+            case 3: [corpus addObject:[NSString stringWithFormat:@"%@ – %@", base, baseStrings[(i * 7) % baseStrings.count]]]; break;
+        }
+    }
+    _corpus = corpus;
+
+    /// Extract format strings
+    ///     Skip strings without literal content since `formatStringRecognizer()` asserts against them.
+    NSMutableArray *formatStrings = [NSMutableArray array];
+    NSMutableArray *formattedStrings = [NSMutableArray array];
+    for (NSString *string in corpus) {
+        BOOL hasLiteralContent = NO;
+        for (NSString *segment in formatStringLiteralSegments(string)) {
+            if ([segment stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceAndNewlineCharacterSet].length > 0) {
+                hasLiteralContent = YES;
+                break;
+            }
+        }
+        if (!hasLiteralContent) continue;
+        [formatStrings addObject:string];
+        [formattedStrings addObject:[formatSpecifierRegex() stringByReplacingMatchesInString:string options:0 range:NSMakeRange(0, string.length) withTemplate:@"42"]];
+    }
+    _formatStrings = formatStrings;
+    _formattedStrings = formattedStrings;
+
+    /// Build decoder record
+    ///     Post-order, like the one recorded while decoding a nib. Each node has 0-4 children, up to depth 8.
+    NSMutableArray *decoderRecord = [NSMutableArray arrayWithCapacity:kDecoderRecordSize];
+    uint32_t seed = 1;
+    while (decoderRecord.count < kDecoderRecordSize - 1) {
+        addDecoderRecordNode(decoderRecord, 1, &seed);
+    }
+    [decoderRecord addObject:@{ @"key": @"IBDocument.RootObjects", @"value": @"root", @"depth": @(0) }];
+    _decoderRecord = decoderRecord;
 }
 
-- (void)tearDown {
-    // Put teardown code here. This method is called after the invocation of each test method in the class.
+static void addDecoderRecordNode(NSMutableArray *decoderRecord, NSInteger depth, uint32_t *seed) {
+
+    *seed = *seed * 1103515245 + 12345; /// Deterministic, so all runs measure the same tree
+    NSUInteger childCount = depth >= 8 ? 0 : (*seed >> 16) % 5;
+    for (NSUInteger i = 0; i < childCount && decoderRecord.count < kDecoderRecordSize - 1; i++) {
+        addDecoderRecordNode(decoderRecord, depth + 1, seed);
+    }
+    [decoderRecord addObject:@{ @"key": @"NSSubviews", @"value": _corpus[decoderRecord.count % _corpus.count], @"depth": @(depth) }];
 }
 
+static NSArray<NSString *> *stringsFromXCStrings(NSString *path) {
+
+    NSMutableArray *result = [NSMutableArray array];
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    if (data == nil) return result;
+    NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+
+    [json[@"strings"] enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *entry, BOOL *stop) {
+        [result addObject:key];
+        [entry[@"localizations"] enumerateKeysAndObjectsUsingBlock:^(NSString *language, NSDictionary *localization, BOOL *stop) {
+            NSString *value = localization[@"stringUnit"][@"value"];
+            if (value != nil) [result addObject:value];
+        }];
+    }];
+    return result;
+}
+
+static NSArray<NSString *> *stringsFromXliff(NSString *path) {
+
+    NSMutableArray *result = [NSMutableArray array];
+    NSURL *url = [NSURL fileURLWithPath:path];
+    NSXMLDocument *document = [[NSXMLDocument alloc] initWithContentsOfURL:url options:0 error:nil];
+    for (NSXMLNode *node in [document nodesForXPath:@"//*[local-name()='source' or local-name()='target']" error:nil]) {
+        [result addObject:node.stringValue];
+    }
+    return result;
+}
+
+#pragma mark - Tests
+
 - (void)testExample {
     // This is an example of a functional test case.
     // Use XCTAssert and related functions to verify your tests produce the correct results.
 }
 
-- (void)testPerformanceExample {
-    // This is an example of a performance test case.
+- (void)testAnnotationRecordRoundTrip {
+    
+    /// Strings that look like parts of the serialized format, plus some that aren't plain ASCII
+    NSArray<NSString *> *strings = @[@"", @"-", @"0:", @"12:3", @"3:abc-", @"MFA1", @"greeting", @"Hallo %@ 12:3", @"line\nbreak", @"Größe 📏", @"--5:"];
+    
+    for (NSUInteger i = 0; i < strings.count; i++) {
+        
+        NSString *(^stringAt)(NSUInteger) = ^NSString *(NSUInteger offset) {
+            return strings[(i + offset) % strings.count];
+        };
+        
+        /// All fields set
+        AnnotationRecord *record = [[AnnotationRecord alloc] init];
+        record.key = stringAt(0);
+        record.string = stringAt(1);
+        record.devString = stringAt(2);
+        record.nibKey = stringAt(3);
+        record.mergedUIString = stringAt(4);
+        record.probablyOverridenBySystemEntry = [LocalizedStringRecordEntry entryWithKey:stringAt(5) value:stringAt(6) table:stringAt(7) result:stringAt(8)];
+        
+        AnnotationRecord *decoded = [AnnotationRecord recordWithSerializedString:record.serializedString];
+        XCTAssertNotNil(decoded);
+        XCTAssertEqualObjects(decoded.key, record.key);
+        XCTAssertEqualObjects(decoded.string, record.string);
+        XCTAssertEqualObjects(decoded.devString, record.devString);
+        XCTAssertEqualObjects(decoded.nibKey, record.nibKey);
+        XCTAssertEqualObjects(decoded.mergedUIString, record.mergedUIString);
+        XCTAssertEqualObjects(decoded.probablyOverridenBySystemEntry.key, record.probablyOverridenBySystemEntry.key);
+        XCTAssertEqualObjects(decoded.probablyOverridenBySystemEntry.value, record.probablyOverridenBySystemEntry.value);
+        XCTAssertEqualObjects(decoded.probablyOverridenBySystemEntry.table, record.probablyOverridenBySystemEntry.table);
+        XCTAssertEqualObjects(decoded.probablyOverridenBySystemEntry.result, record.probablyOverridenBySystemEntry.result);
+        XCTAssertEqualObjects(decoded.serializedString, record.serializedString);
+        
+        /// Only the required fields set
+        AnnotationRecord *minimalRecord = [[AnnotationRecord alloc] init];
+        minimalRecord.key = stringAt(0);
+        minimalRecord.string = stringAt(1);
+        
+        AnnotationRecord *minimalDecoded = [AnnotationRecord recordWithSerializedString:minimalRecord.serializedString];
+        XCTAssertNotNil(minimalDecoded);
+        XCTAssertEqualObjects(minimalDecoded.key, minimalRecord.key);
+        XCTAssertEqualObjects(minimalDecoded.string, minimalRecord.string);
+        XCTAssertNil(minimalDecoded.devString);
+        XCTAssertNil(minimalDecoded.nibKey);
+        XCTAssertNil(minimalDecoded.mergedUIString);
+        XCTAssertNil(minimalDecoded.probablyOverridenBySystemEntry);
+    }
+}
+
+- (void)testAnnotationRecordMalformedInput {
+    
+    /// Truncate and mutate valid records. Decoding must never crash and must only succeed on input that re-encodes to itself (minus ignored trailing fields).
+    
+    AnnotationRecord *record = [[AnnotationRecord alloc] init];
+    record.key = @"greeting";
+    record.string = @"Hallo 12:3";
+    record.devString = @"Hello";
+    NSString *valid = record.serializedString;
+    
+    uint32_t seed = 1;
+    for (NSUInteger i = 0; i < 10000; i++) {
+        seed = seed * 1103515245 + 12345;
+        NSMutableString *mutated = [valid mutableCopy];
+        NSUInteger index = (seed >> 8) % (mutated.length + 1);
+        switch ((seed >> 4) % 3) {
+            case 0: [mutated deleteCharactersInRange:NSMakeRange(index, mutated.length - index)]; break;
+            case 1: if (index < mutated.length) [mutated replaceCharactersInRange:NSMakeRange(index, 1) withString:@[@"-", @":", @"9", @"0", @"x"][(seed >> 16) % 5]]; break;
+            case 2: [mutated insertString:@"1:" atIndex:index]; break;
+        }
+        AnnotationRecord *decoded = [AnnotationRecord recordWithSerializedString:mutated];
+        if (decoded != nil) {
+            XCTAssertTrue([mutated hasPrefix:decoded.serializedString]);
+        }
+    }
+    
+    XCTAssertNil([AnnotationRecord recordWithSerializedString:@""]);
+    XCTAssertNil([AnnotationRecord recordWithSerializedString:@"MFA1"]);
+    XCTAssertNil([AnnotationRecord recordWithSerializedString:@"MFA0-----------"]);
+    XCTAssertNil([AnnotationRecord recordWithSerializedString:@"MFA199999999999999999999999:"]);
+}
+
+- (void)testCaptureRecordingAttributedStringRetrieval {
+    
+    /// `localizedAttributedStringForKey:` goes through the same recording path as `localizedStringForKey:`, but its result is an NSAttributedString. The recording should store the pure string.
+    ///     Note: If the host app was launched with `MFCaptureRecordingPath`, we keep recording to that file instead.
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.mfcap", NSUUID.UUID.UUIDString]];
+    XCTAssertTrue(MFCaptureRecordingStart(path));
+    NSString *recordingPath = [NSUserDefaults.standardUserDefaults stringForKey:@"MFCaptureRecordingPath"].stringByExpandingTildeInPath ?: path;
+    
+    NSString *key = @"test.capture-recording.attributed";
+    NSAttributedString *result = [NSBundle.mainBundle localizedAttributedStringForKey:key value:@"Fallback" table:nil];
+    XCTAssertEqualObjects(result.string, @"Fallback");
+    
+    [NSLocalizedStringRecord removeAllQueuedEntries]; /// Otherwise the UIStringChangeDetector complains about an unhandled localized string on the next runLoop tick
+    MFCaptureRecordingFlush();
+    
+    __block CaptureEvent *retrieval = nil;
+    BOOL success = [CaptureEvent enumerateEventsInFile:recordingPath usingBlock:^(CaptureEvent * _Nonnull event, BOOL * _Nonnull stop) {
+        if (event.type == CaptureEventTypeLocalizedStringRetrieval && [event.key isEqual:key]) {
+            retrieval = event;
+        }
+    }];
+    XCTAssertTrue(success);
+    XCTAssertNotNil(retrieval);
+    XCTAssertEqualObjects(retrieval.value, @"Fallback");
+    XCTAssertEqualObjects(retrieval.result, @"Fallback");
+    XCTAssertFalse(retrieval.isSystemString);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceFormatSpecifierParsing {
+    NSRegularExpression *regex = formatSpecifierRegex();
+    [self measureBlock:^{
+        for (NSString *string in _corpus) {
+            [regex numberOfMatchesInString:string options:0 range:NSMakeRange(0, string.length)];
+        }
+    }];
+}
+
+- (void)testPerformanceFormatStringRecognizerConstruction {
+    [self measureBlock:^{
+        for (NSString *string in _formatStrings) {
+            XCTAssertNotNil(formatStringRecognizer(string));
+        }
+    }];
+}
+
+- (void)testPerformanceUIStringByRemovingLocalizedString {
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < _formatStrings.count; i++) {
+            uiStringByRemovingLocalizedString(_formattedStrings[i], _formatStrings[i]);                             /// Hit
+            uiStringByRemovingLocalizedString(_formattedStrings[i], _formatStrings[(i + 1) % _formatStrings.count]); /// Most likely a miss
+        }
+    }];
+}
+
+- (void)testPerformanceQueue {
+    [self measureBlock:^{
+        Queue<NSString *> *queue = [Queue queue];
+        QueueHandle *handles = malloc(_corpus.count * sizeof(QueueHandle));
+        for (NSUInteger i = 0; i < _corpus.count; i++) {
+            handles[i] = [queue enqueue:_corpus[i]];
+        }
+        for (NSUInteger i = 0; i < _corpus.count; i += 2) {
+            [queue removeObjectWithHandle:handles[i]];
+        }
+        __block NSUInteger visitedCount = 0;
+        [queue enumerateObjectsUsingBlock:^(NSString *obj, QueueHandle handle, BOOL *stop) {
+            visitedCount++;
+        }];
+        XCTAssertEqual(visitedCount, (NSUInteger)queue.count);
+        [queue dequeueAll];
+        free(handles);
+    }];
+}
+
+- (void)testPerformanceTreeFromDecoderRecord {
+    Class annotatorClass = NSClassFromString(@"Annotator");
+    XCTAssertNotNil(annotatorClass);
+    [self measureBlock:^{
+        ArenaTree<KVPair *> *tree = [annotatorClass treeFromDecoderRecord:_decoderRecord];
+        XCTAssertEqual(tree.count, (NSInteger)_decoderRecord.count);
+    }];
+}
+
+- (void)testPerformanceRemoveMarkdownFormatting {
+    [self measureBlock:^{
+        for (NSString *string in _corpus) {
+            removeMarkdownFormatting(string);
+        }
+    }];
+}
+
+- (void)testPerformanceStringHasOnlyLocaleSharedContent {
     [self measureBlock:^{
-        // Put the code you want to measure the time of here.
+        NSUInteger sharedCount = 0;
+        for (NSString *string in _corpus) {
+            sharedCount += stringHasOnlyLocaleSharedContent(string);
+        }
+        XCTAssertLessThanOrEqual(sharedCount, _corpus.count);
     }];
 }
 